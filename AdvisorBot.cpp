@@ -1,21 +1,222 @@
-// Merkelrex.cpp : This file contains the 'main' function. Program execution begins and ends there.
-//
-
-#include <iostream>
-#include <string>
-#include <vector>
-#include <fstream>
-#include "OrderBookEntry.h"
-#include "AdvisorMain.h"
-#include "CSVReader.h"
-
-
-int main() {
-	AdvisorMain app{};
-	app.init();
-
-	
-}
-
-
-
+// Merkelrex.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "OrderBookEntry.h"
+#include "AdvisorMain.h"
+#include "CSVReader.h"
+#include "AdvisorServer.h"
+#include "LoadGenerator.h"
+#include "CSVTail.h"
+#include "DataGenerator.h"
+#include "Benchmark.h"
+#include <memory>
+
+
+/** parses the number after an option, returns false and prints why if it is not one */
+static bool readNumber(int argc, char* argv[], int& i, size_t& number) {
+	std::string option = argv[i];
+	if (i + 1 >= argc) {
+		std::cout << option << " needs a number" << std::endl;
+		return false;
+	}
+	try {
+		number = std::stoul(argv[++i]);
+	} catch (const std::exception& e) {
+		std::cout << option << " needs a number" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	OrderBookOptions options;
+	std::string batchFile; // commands to run instead of the interactive mode, "-" reads them from stdin
+	BatchFormat batchFormat = BatchFormat::text;
+	bool formatSent = false;
+	ServerOptions serverOptions; // serves clients over a socket when its path is set
+	LoadGeneratorOptions loadOptions; // loads a running server when its path is set
+	std::string dataDirectory; // daily csv files read as one timeline, instead of 20200601.csv
+	size_t memoryBudget = 0; // bytes of loaded days kept before the least recently used are dropped, 0 keeps them all
+	std::string generateFile; // writes a synthetic dataset to this file when set
+	DataGeneratorOptions generatorOptions;
+	BenchmarkOptions benchmarkOptions;
+	bool benchmark = false;
+	bool dumpStats = false; // prints the command latencies and load timings to stderr when the program ends
+	size_t number;
+
+	for (int i = 1; i < argc; i++) { // command line options
+		std::string arg = argv[i];
+		if (arg == "--threads") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			options.loadThreads = static_cast<unsigned int>(number); // 0 parses the dataset on every hardware thread
+		} else if (arg == "--no-snapshot") {
+			options.useSnapshot = false;
+		} else if (arg == "--out-of-core") {
+			options.outOfCore = true; // rows stay in a compressed block file next to each csv file, decoded as queries need them
+		} else if (arg == "--page-budget") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			options.pageBudget = number * 1024 * 1024; // sent in MB
+		} else if (arg == "--follow") {
+			options.follow = true; // new timesteps appended to the dataset are added while the program runs
+		} else if (arg == "--stats") {
+			dumpStats = true;
+		} else if (arg == "--data" && i + 1 < argc) {
+			dataDirectory = argv[++i];
+		} else if (arg == "--memory-budget") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			memoryBudget = number * 1024 * 1024; // sent in MB
+		} else if (arg == "--batch" && i + 1 < argc) {
+			batchFile = argv[++i];
+		} else if (arg == "--format" && i + 1 < argc) {
+			std::string format = argv[++i];
+			formatSent = true;
+			if (format == "text") batchFormat = BatchFormat::text;
+			else if (format == "tsv") batchFormat = BatchFormat::tsv;
+			else if (format == "jsonl") batchFormat = BatchFormat::jsonl;
+			else {
+				std::cout << "--format needs text, tsv or jsonl" << std::endl;
+				return 1;
+			}
+		} else if (arg == "--serve" && i + 1 < argc) {
+			serverOptions.socketPath = argv[++i];
+		} else if (arg == "--workers") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			serverOptions.workers = static_cast<unsigned int>(number);
+		} else if (arg == "--loadgen" && i + 1 < argc) {
+			loadOptions.socketPath = argv[++i];
+		} else if (arg == "--clients") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			loadOptions.clients = static_cast<unsigned int>(number);
+		} else if (arg == "--requests") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			loadOptions.requests = number;
+		} else if (arg == "--commands" && i + 1 < argc) {
+			loadOptions.commandFile = argv[++i];
+		} else if (arg == "--generate" && i + 1 < argc) {
+			generateFile = argv[++i];
+		} else if (arg == "--products") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			generatorOptions.products = number;
+		} else if (arg == "--timesteps") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			generatorOptions.timesteps = number;
+		} else if (arg == "--orders") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			generatorOptions.ordersPerTimestep = number;
+		} else if (arg == "--size") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			generatorOptions.fileSize = number * 1024 * 1024; // sent in MB
+		} else if (arg == "--seed") {
+			if (!readNumber(argc, argv, i, number)) return 1;
+			generatorOptions.seed = number;
+		} else if (arg == "--bench" && i + 1 < argc) {
+			benchmark = true;
+			benchmarkOptions.directory = argv[++i];
+		} else if (arg == "--bench-sizes" && i + 1 < argc) {
+			benchmarkOptions.sizes.clear();
+			std::string sizes = argv[++i];
+			try {
+				for (size_t start = 0; start < sizes.size();) { // comma separated timestep counts
+					size_t comma = sizes.find(',', start);
+					if (comma == std::string::npos) comma = sizes.size();
+					benchmarkOptions.sizes.push_back(std::stoul(sizes.substr(start, comma - start)));
+					start = comma + 1;
+				}
+			} catch (const std::exception& e) {
+				benchmarkOptions.sizes.clear();
+			}
+			if (benchmarkOptions.sizes.empty()) {
+				std::cout << "--bench-sizes needs timestep counts separated by commas" << std::endl;
+				return 1;
+			}
+		} else {
+			std::cout << "Usage: AdvisorBot [--threads <no>] [--no-snapshot] [--out-of-core [--page-budget <MB>]] [--follow] [--stats] [--data <dir> [--memory-budget <MB>]] [--batch <file or -> [--format text|tsv|jsonl]]" << std::endl;
+			std::cout << "       AdvisorBot [--threads <no>] [--no-snapshot] [--out-of-core [--page-budget <MB>]] [--follow] [--stats] [--data <dir> [--memory-budget <MB>]] --serve <socket> [--workers <no>] [--format tsv|jsonl]" << std::endl;
+			std::cout << "       AdvisorBot --loadgen <socket> [--clients <no>] [--requests <no>] [--commands <file>]" << std::endl;
+			std::cout << "       AdvisorBot --generate <file> [--products <no>] [--timesteps <no> | --size <MB>] [--orders <no>] [--seed <no>]" << std::endl;
+			std::cout << "       AdvisorBot [--threads <no>] --bench <dir> [--bench-sizes <timesteps,...>] [--products <no>] [--orders <no>] [--seed <no>]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (!loadOptions.socketPath.empty()) { // the load generator only talks to a server, it does not load the dataset
+		LoadGeneratorReport report;
+		if (!LoadGenerator::run(loadOptions, report)) {
+			return 1;
+		}
+		LoadGenerator::printReport(report, std::cout);
+		return report.errors == 0 ? 0 : 1;
+	}
+
+	if (!generateFile.empty()) {
+		DataGeneratorResult result;
+		if (!DataGenerator::writeFile(generatorOptions, generateFile, result)) {
+			return 1;
+		}
+		std::cout << "Wrote " << result.timesteps << " timesteps, " << result.rows << " rows, " << result.bytes << " bytes to " << generateFile << std::endl;
+		return 0;
+	}
+
+	if (benchmark) { // times ingest and the commands on generated datasets, instead of loading the exchange dataset
+		benchmarkOptions.generator = generatorOptions;
+		benchmarkOptions.load = options;
+		return Benchmark::run(benchmarkOptions, std::cout) ? 0 : 1;
+	}
+
+	std::vector<std::string> files{"20200601.csv"};
+	if (!dataDirectory.empty()) {
+		files = DatasetCatalog::scanDirectory(dataDirectory);
+		if (files.empty()) {
+			std::cerr << "No csv files in " << dataDirectory << std::endl;
+			return 1;
+		}
+	}
+	DatasetCatalog catalog{files, options, memoryBudget};
+	std::unique_ptr<CSVTail> tail;
+	if (options.follow) { // the newest day is the one a feed appends to
+		tail.reset(new CSVTail{*catalog.getLiveDay(), files.back()});
+		tail->start();
+	}
+
+	CommandStats stats; // shared by every session
+	if (!serverOptions.socketPath.empty()) { // one catalog, shared by the sessions of every client
+		if (formatSent) serverOptions.format = batchFormat;
+		AdvisorServer server{catalog, serverOptions, stats};
+		bool served = server.run();
+		if (dumpStats) {
+			AdvisorMain{catalog, &stats}.printStats(std::cerr);
+		}
+		return served ? 0 : 1;
+	}
+
+	if (batchFile.empty()) {
+		AdvisorMain app{catalog, &stats};
+		app.init();
+		if (dumpStats) app.printStats(std::cerr);
+		return 0;
+	}
+
+	std::ifstream commandFile;
+	if (batchFile != "-") {
+		commandFile.open(batchFile);
+		if (!commandFile.is_open()) {
+			std::cerr << "Could not open " << batchFile << std::endl;
+			return 1;
+		}
+	}
+	// answers are only flushed when the buffer fills or the batch ends, not per line
+	std::ios::sync_with_stdio(false);
+	std::cin.tie(nullptr);
+
+	AdvisorMain app{catalog, &stats};
+	app.runBatch(batchFile == "-" ? std::cin : commandFile, std::cout, batchFormat);
+	std::cout.flush();
+	if (dumpStats) app.printStats(std::cerr);
+	return std::cout ? 0 : 1;
+
+	
+}
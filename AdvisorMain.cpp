@@ -1,551 +1,1185 @@
-#include "AdvisorMain.h"
-#include "OrderBookEntry.h"
-#include <iostream>
-#include <iomanip>
-#include <vector>
-#include <string>
-#include "CSVReader.h"
-
-AdvisorMain::AdvisorMain() {
-
-}
-
-void AdvisorMain::init() { // initializes the program
-	std::string input; 
-	currentTime = orderBook.getEarliestTime(); // user starts at the first timestamp in the dataset
-	printMenu();
-
-	while (true) { // constant while loop while program is running, awaiting the user's input
-		input = getUserOption();
-		processUserOption(input);
-	}
-}
-
-void AdvisorMain::printMenu() { // prints introduction to the advisorbot when the program first initializes
-	std::cout << "Welcome to Advisorbot. Advisorbot is a command line program that can carry out various" << std::endl;
-	std::cout << "tasks to help a cryptocurrency investor analyse the data available on an exchange." << std::endl;
-	std::cout << "======================================================================================" << std::endl;
-	std::cout << "To begin, please enter a command, or type 'help' for a list of commands" << std::endl;
-}
-
-void AdvisorMain::printHelp(std::string userOption) { //print help function, when prints all available commands, and also prints each command's use and purpose
-	if (userOption == "help") {
-		std::cout << "The available commands are: help, help <cmd>, prod, min, max, avg, predict, liquidity, time, step <no>" << std::endl;
-		std::cout << "======================================================================================================" << std::endl;
-	} else if (userOption == "help prod") {
-		std::cout << "Command: prod" << std::endl;
-		std::cout << "Purpose: List all available products." << std::endl;
-		std::cout << "Example: user> help prod" << std::endl;
-		std::cout << "         advisorbot> ETH/BTC, DOGE/BTC etc." << std::endl;
-	} else if (userOption == "help min") {
-		std::cout << "Command: min product bid/ask" << std::endl;
-		std::cout << "Purpose: Find the minimum bid or ask for product in current time step" << std::endl;
-		std::cout << "Example: user> min ETH/BTC ask" << std::endl;
-		std::cout << "         advisorbot> The min ask for ETH/BTC is 0.0248261" << std::endl;
-	} else if (userOption == "help max") {
-		std::cout << "Command: max product bid/ask" << std::endl;
-		std::cout << "Purpose: Find the maximum bid or ask for product in current time step" << std::endl;
-		std::cout << "Example: user> max ETH/BTC ask" << std::endl;
-		std::cout << "         advisorbot> The max ask for ETH/BTC is 0.0251581" << std::endl;
-	} else if (userOption == "help avg") {
-		std::cout << "Command: avg product ask/bid timesteps" << std::endl;
-		std::cout << "Purpose: Compute the average ask or bid for the sent product over the sent number of time steps" << std::endl;
-		std::cout << "Example: user> avg ETH/BTC ask 10" << std::endl;
-		std::cout << "         advisorbot> The average ETH/BTC ask price over the last 10 timesteps was 0.0249612" << std::endl;
-	} else if (userOption == "help predict") {
-		std::cout << "Command: predict max/min product ask/bid" << std::endl;
-		std::cout << "Purpose: Predict the max or min ask or bid for the sent product for the next time step, requires user to be at minimum the 5th timestamp" << std::endl;
-		std::cout << "Example: user> predict max BTC/USDT bid" << std::endl;
-		std::cout << "         advisorbot> The predicted max ask price for ETH/BTC is 0.0222814 for the next time frame" << std::endl;
-	} else if (userOption == "help liquidity") {
-		std::cout << "Command: liquidity product" << std::endl;
-		std::cout << "Purpose: Averages the liquidity of product for the past 10 timesteps, uses bid-ask spread as the measure" << std::endl;
-		std::cout << "Example: user> liquidity DOGE/BTC" << std::endl;
-		std::cout << "         advisorbot> The average liquidity of DOGE/BTC for the previous 10 steps is 4.07%" << std::endl;
-	} else if (userOption == "help time") {
-		std::cout << "Command: time" << std::endl;
-		std::cout << "Purpose: State current time in dataset, i.e. which timeframe are we looking at" << std::endl;
-		std::cout << "Example: user> time" << std::endl;
-		std::cout << "         advisorbot> Current time is 2020/03/17 17:01:24, timestamp: 5" << std::endl;
-	} else if (userOption == "help step") {
-		std::cout << "Command: step <no.>" << std::endl;
-		std::cout << "Purpose: Moves to the next specified amount of timesteps, defaults to 1" << std::endl;
-		std::cout << "Example: user> step" << std::endl;
-		std::cout << "         advisorbot> Now at 2020/03/17 17:01:30" << std::endl;
-	} else { // if none of the above was matched, returns invalid input statement and tells user to type help for all valid commands
-		std::cout << "Invalid input. Type 'help' to display all valid commands" << std::endl;
-	}
-}
-
-void AdvisorMain::printProducts() { // 'prod' command, prints out all available products in the dataset
-	bool first = true;
-	std::cout << "Known products: " << "";
-	for (std::string const& p : orderBook.getKnownProducts()) { // Gets all known products from the orderbook using getKnownProducts function
-		if (!first) {
-			std::cout << "," << p << ""; // separates the products with commas to be printed
-		} else {
-			std::cout << p << "";
-			first = false;
-		}
-	}
-	std::cout << std::endl;
-}
-
-void AdvisorMain::printMinMax(std::string userOption) { // Minimum / Maximum command which returns the min/max as/bid of the product the user has input 
-
-	std::vector<std::string> userOptionLine = userOptionTokenise(userOption);
-
-	int valid = 0;
-	for (std::string const& p : orderBook.getKnownProducts()) { // counts the number of products in the current timeframe to be used for validation
-		valid++;
-	};
-
-	if (userOptionLine.size() != 3) { // user input must be a line which can be separated into 3 individual strings
-		std::cout << "Wrong line input, type 'help <cmd>' for a valid command input" << std::endl;
-	} else {
-
-		std::string type = userOptionLine[2];
-		std::string product = userOptionLine[1];
-
-		if (product.rfind("DOGE", 0) == 0) { // Changing precision when printing DOGE products to show more accurately their value rather than scientific notations
-			std::cout.precision(10);
-			std::cout << std::fixed;
-		}
-		else { // If user is analysing other products, change back the precision to the default
-			std::cout.precision(-1);
-			std::cout << std::defaultfloat;
-		}
-
-		for (std::string const& p : orderBook.getKnownProducts()) { // loops through the known products to match whichever product the user has input
-			if ((type == "bid" || type == "ask") && product == p) { // validates if their input contains bid/ask and also matches the product to their input 
-				std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime); //gets the order book entry depending on the bid/ask which the user input
-				if (userOptionLine[0] == "min") { // matches if the user wanted to search for min
-					std::cout << "The min " << type << " for " << product << " is " << OrderBook::getLowPrice(entries) << std::endl;
-				}
-				else if (userOptionLine[0] == "max") {// matches if the user wanted to search for max
-					std::cout << "The max " << type << " for " << product << " is " << OrderBook::getHighPrice(entries) << std::endl;
-				}
-			}
-			else {
-				valid--; // How many ever products is in the timestamp, the for loop should match 1 out of x products and have valid equal to 1
-			}
-		}
-		if (valid != 1) { // If 1 line of data is not matched in the for loop, the input is not valid and prints wrong line input
-			std::cout << "Wrong line input, type 'help <cmd>' for a valid command input" << std::endl;
-		}
-	}
-
-}
-
-void AdvisorMain::printAvg(std::string userOption) { // Average command. Averages the ask/bid of a product for the x past numbers of timesteps
-
-	std::vector<std::string> userOptionLine = userOptionTokenise(userOption);
-
-	// variables needed for the average function
-	int valid = 0;
-	for (std::string const& p : orderBook.getKnownProducts()) { // counts the number of products in the current timeframe to be used for validation
-		valid++;
-	};
-	double avg = 0;
-	double sum = 0;
-	unsigned int timesteps; // How many past timesteps (including current) the user wants to average
-	unsigned int userTimeStamp; // Which timestamp the user is current at
-	bool first = true;
-
-	if (userOptionLine.size() != 4) { // user input must be a line which can be separated into 4 individual strings from a vector
-		std::cout << "Wrong line input, type 'help <cmd>' for a valid command input" << std::endl;
-	}
-	else {
-		std::string type = userOptionLine[2];
-		std::string product = userOptionLine[1];
-
-		try {
-			timesteps = std::stoi(userOptionLine[3]); // convert user's input from string to int
-		} catch (const std::exception& e) {
-			std::cout << "Please input a number for your timesteps" << std::endl;
-			timesteps = 0;
-			return; // If user inputs non int for timestep value, return without executing any more code
-		}
-
-		try {
-			if (type != "ask" && type != "bid") { // validation to check if user inputed a valid type
-				std::cout << "Wrong line input, please check order of commands" << std::endl;
-				return;
-			}
-		} catch (const std::exception& e) {
-			//
-		}
-
-		if (product.rfind("DOGE", 0) == 0) { // Changing precision when printing DOGE products to show more accurately their value rather than scientific notations
-			std::cout.precision(10);
-			std::cout << std::fixed;
-		}
-		else { // If user is analysing other products, change back the precision to the default
-			std::cout.precision(-1);
-			std::cout << std::defaultfloat;
-		}
-
-		userTimeStamp = timeStepsTaken + 1; // timestepstaken is how many time steps the user taken which starts at 0, usertimestamp starts at 1
-		
-		if (timesteps == userTimeStamp && timesteps > 1) { // if the user wants to analyse all the timestamps they have passed through, minus
-			timesteps--;								   // timesteps to go back by 1 so that they dont go 1 further back
-		}
-
-		if (timesteps > userTimeStamp) { // validation if the user inputs more timesteps to analyse than their current timestamp number
-			std::cout << "You entered a greater number of timesteps to your current timestamp, please enter a timestep equal or less than your timestamp" << std::endl;
-			return;
-		} else if (timesteps == 0) {
-			std::cout << "Please enter a number greater than 0" << std::endl;
-			return;
-		}
-
-		for (std::string const& p : orderBook.getKnownProducts()) {
-
-			if ((type == "bid" || type == "ask") && product == p && userOptionLine[0] == "avg" && userTimeStamp >= timesteps) {
-				if (userTimeStamp == 1) { // If the user has not taken any timesteps; they are on the first time stamp, do not go back any timestamps
-					std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime);
-					sum += OrderBook::getAvgPrice(entries);
-				}
-				else {
-					for (int i = 0; i < timesteps; i++) {
-
-						std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime); 
-						sum += OrderBook::getAvgPrice(entries); // sums the average price each loop for current time
-
-						gotoPrevTimeFrame(); // go back 1 timestamp
-
-						// For the last iteration of the loop, add to the sum of average prices but do no go back 1 timestamp
-						if (i == (timesteps - 1) && userTimeStamp == stoi(userOptionLine[3])) { 
-							std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime);
-							sum += OrderBook::getAvgPrice(entries);
-						}
-					}
-				}
-
-				avg = sum / stoi(userOptionLine[3]); // the average past x timestamps is the sum of entries average divided by timesteps
-
-				std::cout << "The average " << product << " " << type << " price over the last " << stoi(userOptionLine[3]) << " timesteps was " << avg << std::endl;
-
-			} else {
-				valid--;
-			}
-
-		}
-		if (valid != 1) {
-			std::cout << "Wrong line input, type 'help <cmd>' for a valid command input" << std::endl;
-		}
-		else {
-			if (timesteps == 1) { // if user only wants to avg current timestamp values, moves user forward only 1 timestamp as above function they are sent back once
-				for (int i = 0; i < 1; i++) {
-					if (userTimeStamp != 1) {
-						gotoNextTimeFrame("return"); // returns the user to their original timestamp
-					}
-				}
-			}
-			else {
-				// this for loop returns the user's time step to wherever they stepped to
-				for (int i = 0; i < timesteps; i++) {
-					if (userTimeStamp != 1) { // if user has not taken any timesteps, they can only avg the first timestep
-						gotoNextTimeFrame("return");
-					}
-				}
-			}
-		}
-		//std::cout << "Current time stamp is " << currentTime << " Timestamp: " << timeStepsTaken + 1 << std::endl;
-	}
-
-}
-
-
-void AdvisorMain::printPredict(std::string userOption) { // Predict function uses 4 steps exponential moving average to predict the next min/max ask/bid for the product
-
-	std::vector<std::string> userOptionLine = userOptionTokenise(userOption);
-
-	//variables needed for the function
-	int valid = 0;
-	for (std::string const& p : orderBook.getKnownProducts()) { // counts the number of products in the current timeframe to be used for validation
-		valid++;
-	};
-	double sum = 0;
-	double EMA, SMA, CurrentPrice;
-	unsigned int timesteps = 4; // Using 4 step moving average as predictor, EMA requires the SMA of the previous step
-
-	//predict max/min product ask/bid
-	//   0	     1	     2	     3
-	// EMA = Current price * (2/5) + SMA of previous * (3/5)
-
-	if (userOptionLine.size() != 4) { // user input must be a line which can be separated into 4 individual strings
-		std::cout << "Wrong line input, type 'help <cmd>' for a valid command input" << std::endl;
-	} else if (timeStepsTaken < 4) { // Function works by using past 5 timesteps data so can only use this command on the 5th timestamp onwards
-		std::cout << "Predict can only be used on the 5th timestamp onwards as it uses historical data" << std::endl;
-	} else {
-
-		std::string type = userOptionLine[3];
-		std::string product = userOptionLine[2];
-		std::string minmax = userOptionLine[1];
-
-		try {  // validation for ask/bid and min/max if they are input in the correct order of commands
-			if (type != "ask" && type != "bid") {
-				std::cout << "Wrong line input, please check order of commands" << std::endl;
-				return;
-			}
-			else if (minmax != "max" && minmax != "min") {
-				std::cout << "Wrong line input, please check order of commands" << std::endl;
-				return;
-			}
-		}
-		catch (const std::exception& e) {
-			//
-		}
-
-		if (product.rfind("DOGE", 0) == 0) { // Changing precision when printing DOGE products to show more accurately their value rather than scientific notations
-			std::cout.precision(10);
-			std::cout << std::fixed;
-		}
-		else { // If user is analysing other products, change back the precision to the default
-			std::cout.precision(-1);
-			std::cout << std::defaultfloat;
-		}
-
-		for (std::string const& p : orderBook.getKnownProducts()) {
-
-			if ((type == "ask" || type == "bid") && product == p) { // matches the product
-				for (int i = 0; i < timesteps; i++) {
-					if (minmax == "min") { // matches if they user wants to analyse min
-						if (i == 0) {
-							std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime);
-							CurrentPrice = OrderBook::getLowPrice(entries);
-						}
-						else {
-							std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime);
-							sum += OrderBook::getLowPrice(entries);
-						}
-						gotoPrevTimeFrame();
-						if (i == 3) { // on i = 3 iteration, gotoPrevTimeFrame() has been executed 4 times, meaning the user has went back to the 5th time stamp
-							std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime);
-							sum += OrderBook::getLowPrice(entries); // gets the value of the 5th step value as it is required for SMA, 
-						}
-					}
-					else if (minmax == "max") { // matches if they user wants to analyse max
-						if (i == 0) {
-							std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime);
-							CurrentPrice = OrderBook::getHighPrice(entries);
-						}
-						else {
-							std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime);
-							sum += OrderBook::getHighPrice(entries);
-						}
-						gotoPrevTimeFrame();
-						if (i == 3) {
-							std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(type), p, currentTime);
-							sum += OrderBook::getHighPrice(entries); 
-						}
-					}
-				}
-				SMA = sum / 4; // formula for Simple moving average, sum of 5th to 2nd timestamps divided by 4
-				EMA = CurrentPrice * (2.0 / 5.0) + SMA * (3.0 / 5.0); // formula for Exponential moving average, which uses the SMA of previous step and current step price
-				std::cout << "The " << minmax << " " << type << " for " << product << " might be " << EMA << " for the next timestep" << std::endl;
-			} else {
-				valid--;
-			}
-		}
-		if (valid != 1) {
-			std::cout << "Wrong line input, type 'help <cmd>' for a valid command input" << std::endl;
-		}
-		else {
-			// this for loop returns the user's time step to wherever they stepped to
-			for (int i = 0; i < 4; i++) {
-				if (timeStepsTaken >= 4) { // Function will not execute if users have not taken more than 4 steps
-					gotoNextTimeFrame("return");
-				}
-
-			}
-		}
-
-		//std::cout << "Current time stamp is " << currentTime << " Timestamp: " << timeStepsTaken + 1 << std::endl;
-	}
-
-}
-
-void AdvisorMain::printLiquidity(std::string userOption) { // Liquidity function takes the product's average bid-ask spread of the 10 previous steps in %
-
-	std::vector<std::string> userOptionLine = userOptionTokenise(userOption);
-
-	// variables needed for liquidty function
-	int valid = 0;
-	for (std::string const& p : orderBook.getKnownProducts()) { // counts the number of products in the current timeframe to be used for validation
-		valid++;
-	};
-	double sumOfLiquidity = 0;
-	double avgOfLiquidity = 0;
-	double BidAskSpread;
-	double liquidity;
-	unsigned int timesteps = 10; // Using 10 step average of liquidity%, as some day
-
-	//liquidity product 
-	//   0	       1
-	// Bid ask spread = min ask  max bid
-	// Liquidity % = (bid ask spread / lowest ask price)* 100
-
-	if (userOptionLine.size() != 2) { // user input must be a line which can be separated into 2 individual strings
-		std::cout << "Wrong line input, type 'help <cmd>' for a valid command input" << std::endl;
-	}
-	else if (timeStepsTaken < timesteps) { // User has to be on 11th timestamp onwards to use this function
-		std::cout << "Liquidity can only be used on the 11th timestamp onwards as it uses historical data" << std::endl;
-	}
-	else {
-
-		std::string product = userOptionLine[1];
-
-		if (product.rfind("DOGE", 0) == 0) { // Changing precision when printing DOGE products to show more accurately their value rather than scientific notations
-			std::cout.precision(10);
-			std::cout << std::fixed;
-		}
-		else { // If user is analysing other products, change back the precision to the default
-			std::cout.precision(-1);
-			std::cout << std::defaultfloat;
-		}
-
-		for (std::string const& p : orderBook.getKnownProducts()) {
-			if (product == p) { // matches user's product input to the dataset's product
-				for (int i = 0; i < timesteps; i++) { 
-					std::vector<OrderBookEntry> askEntries = orderBook.getOrders(OrderBookType::ask, p, currentTime);
-					std::vector<OrderBookEntry> bidEntries = orderBook.getOrders(OrderBookType::bid, p, currentTime);
-					BidAskSpread = OrderBook::getLowPrice(askEntries) - OrderBook::getHighPrice(bidEntries);
-					liquidity = (BidAskSpread / OrderBook::getLowPrice(askEntries)) * 100;
-					sumOfLiquidity += liquidity;
-					gotoPrevTimeFrame();
-					if (i == timesteps - 1) { // on the last iteration of the loop, gets the value of the 10th day
-						std::vector<OrderBookEntry> askEntries = orderBook.getOrders(OrderBookType::ask, p, currentTime);
-						std::vector<OrderBookEntry> bidEntries = orderBook.getOrders(OrderBookType::bid, p, currentTime);
-						BidAskSpread = OrderBook::getLowPrice(askEntries) - OrderBook::getHighPrice(bidEntries);
-						liquidity = (BidAskSpread / OrderBook::getLowPrice(askEntries)) * 100;
-						sumOfLiquidity += liquidity;
-					}
-				}
-				avgOfLiquidity = sumOfLiquidity / timesteps; // Formula for average of liquidity for the last 10 days
-				std::cout << std::setprecision(2) << "The average liquidity of " << product << " for the previous 10 steps is " << avgOfLiquidity << "%" << std::endl;
-			}
-			else {
-				valid--;
-			}
-
-		}
-
-		if (valid != 1) {
-			std::cout << "Wrong line input, type 'help <cmd>' for a valid command input" << std::endl;
-		}
-		else {
-
-			// this for loop returns the user's time step to wherever they stepped to
-			for (int i = 0; i < timesteps; i++) {
-				if (timeStepsTaken >= timesteps) { // Function will not execute if users have not taken more than 10 steps
-					gotoNextTimeFrame("return");
-				}
-
-			}
-		}
-
-		//std::cout << "Current time stamp is " << currentTime << " Timestamp: " << timeStepsTaken + 1 << std::endl;
-	}
-
-
-}
-
-
-
-void AdvisorMain::gotoNextTimeFrame(std::string userOption) {
-	std::string original = userOption;
-	std::vector<std::string> userOptionLine = userOptionTokenise(userOption);
-
-	signed int steps; // If unsigned int is used, user inputting negative number will crash the program
-	if (original == "step") { // 'step' defaults to advancing 1 time step
-		currentTime = orderBook.getNextTime(currentTime);
-		std::cout << "Now at " << currentTime << std::endl;
-		timeStepsTaken++; // adds 1 to the timestepstaken
-	} else if (original == "return") { // used for returning to timestamp after calculating commands, will not add to timestepstaken
-		currentTime = orderBook.getNextTime(currentTime);
-		//std::cout << "Now at " << currentTime << std::endl;
-	} else if (userOptionLine.size() == 2) { // 'step <no>' users can type how many steps they want to advance, and for loop will advance x numbers of step
-		try {
-			steps = std::stoi(userOptionLine[1]);
-			if (!(steps <= 0)) {
-				for (int i = 0; i < steps; i++) {
-					currentTime = orderBook.getNextTime(currentTime);
-					if (i == steps - 1) {
-						std::cout << "Now at " << currentTime << std::endl;
-					}
-					timeStepsTaken++;
-				}
-			} else {
-				std::cout << "Please enter a step greater than 0" << std::endl;
-			}
-		}
-		catch (const std::exception& e) { // validation
-			std::cout << "Invalid input. Type 'help' to display all valid commands" << std::endl;
-		}
-	} else { // validation
-		std::cout << "Invalid input. Type 'help' to display all valid commands" << std::endl;
-	}
-
-
-}
-
-void AdvisorMain::gotoPrevTimeFrame() { // Function to send user back 1 time step, for the different commands to get past timesteps data for calculation
-
-	currentTime = orderBook.getPrevTime(currentTime); 
-	//std::cout << "Now at " << currentTime << std::endl;
-
-}
-
-std::string AdvisorMain::getUserOption() { // Takes the user's input using cin and returns a string line
-	std::string userOption;
-	std::string line;
-	std::getline(std::cin, line);
-	try {
-		userOption = std::string(line);
-	} catch (const std::exception& e){
-		//
-	}
-	return userOption;
-}
-
-std::vector<std::string> AdvisorMain::userOptionTokenise(std::string userOption) { // tokenise user's input into a vector
-	std::vector<std::string> userOptionLine;
-	signed int start, end;
-	std::string token;
-	start = userOption.find_first_not_of(" ", 0);
-	do {
-		end = userOption.find_first_of(" ", start);
-		if (start == userOption.length() || start == end) break;
-		if (end >= 0) token = userOption.substr(start, end - start);
-		else token = userOption.substr(start, userOption.length() - start);
-		userOptionLine.push_back(token);
-		start = end + 1;
-	} while (end > 0);
-	return userOptionLine;
-}
-
-void AdvisorMain::processUserOption(std::string userOption) { // Processes the user's input and uses rfind to match which command the user has input
-
-	if (userOption.rfind("help", 0) == 0) { //Print all commands and their uses
-		printHelp(userOption);
-	} else if (userOption == "prod") { // Displays all products
-		printProducts();
-	} else if (userOption.rfind("min", 0) == 0 || userOption.rfind("max", 0) == 0) { // Displays min/max ask/bid for product
-		printMinMax(userOption);
-	} else if (userOption.rfind("avg", 0) == 0) { // Displays avg ask/bid for product
-		printAvg(userOption);
-	} else if (userOption.rfind("predict", 0) == 0) { // Displays prediction for max/min product ask/bid using weighted moving avg
-		printPredict(userOption);
-	} else if (userOption == "time") { // Displays current time frame
-		std::cout << "Current time is " << currentTime << " Timestamp: " << timeStepsTaken + 1 << std::endl;
-	} else if (userOption.rfind("step", 0) == 0) { // Progresses to the next time frame
-		gotoNextTimeFrame(userOption);
-	} else if (userOption.rfind("liquidity", 0) == 0) {
-		printLiquidity(userOption);
-	} else { //If none of the valid commands are typed, invalid input and prompts user to type help
-		std::cout << "Invalid input. Type 'help' to display all valid commands" << std::endl;
-	}
-
-}
\ No newline at end of file
+#include "AdvisorMain.h"
+#include "OrderBookEntry.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include <string>
+#include "CSVReader.h"
+#include "Timestamp.h"
+
+const char* const AdvisorMain::username = "simuser";
+
+AdvisorMain::AdvisorMain() : AdvisorMain(OrderBookOptions{}) {
+
+}
+
+AdvisorMain::AdvisorMain(OrderBookOptions options)
+	: ownedCatalog{new DatasetCatalog{{"20200601.csv"}, options}}, catalog{*ownedCatalog}, ownedStats{new CommandStats}, commandStats{ownedStats.get()} {
+	liveDay = catalog.getLiveDay();
+	moveToDay(0);
+}
+
+AdvisorMain::AdvisorMain(DatasetCatalog& _catalog, CommandStats* _stats) : catalog{_catalog}, commandStats{_stats} {
+	if (commandStats == nullptr) {
+		ownedStats.reset(new CommandStats);
+		commandStats = ownedStats.get();
+	}
+	liveDay = catalog.getLiveDay();
+	moveToDay(0);
+}
+
+void AdvisorMain::moveToDay(size_t day) { // the cursor keeps its day loaded, and the indicator caches belong to that day's orderbook
+	currentStep = 0;
+	if (book && day == currentDay) {
+		return;
+	}
+	currentDay = day;
+	book = catalog.getDay(day);
+	indicators.reset(new IndicatorEngine{*book});
+}
+
+void AdvisorMain::moveForward(size_t steps) { // moves the cursor steps timesteps on, into the next days, wrapping from the last day to the first
+	size_t lap = 0; // timesteps passed since the cursor last went through the start of the timeline, 0 until it has
+	bool startSeen = false;
+	while (currentStep + steps >= book->getTimestepCount()) {
+		size_t toNextDay = book->getTimestepCount() - currentStep;
+		steps -= toNextDay;
+		lap += toNextDay;
+		moveToDay((currentDay + 1) % catalog.getDayCount());
+		if (currentDay == 0) {
+			if (startSeen) { // a whole lap of the timeline, the rest of the steps only repeat it
+				if (lap == 0) return; // every day is empty
+				steps %= lap;
+			}
+			startSeen = true;
+			lap = 0;
+		}
+	}
+	currentStep += steps;
+}
+
+void AdvisorMain::init() { // initializes the program
+	std::string input; 
+	moveToDay(0); // user starts at the first timestamp in the dataset
+	out = &std::cout;
+	printMenu();
+
+	while (getUserOption(input)) { // loop while program is running, awaiting the user's input until the input ends
+		std::shared_lock<std::shared_mutex> view = readLock(); // a followed book does not change while a command runs
+		processUserOption(input);
+	}
+}
+
+size_t AdvisorMain::windowLength(const std::pmr::vector<DaySegment>& window) {
+	size_t timesteps = 0;
+	for (const DaySegment& segment : window) {
+		timesteps += segment.lastStep - segment.firstStep + 1;
+	}
+	return timesteps;
+}
+
+size_t AdvisorMain::runBatch(std::istream& commands, std::ostream& output, BatchFormat format) { // runs every line of commands as if the user typed it, without the menu
+	std::string input;
+	size_t lineNumber = 0;
+	moveToDay(0);
+	while (std::getline(commands, input)) {
+		stripCarriageReturn(input);
+		lineNumber++;
+		runCommand(input, lineNumber, output, format);
+	}
+	out = &std::cout;
+	return lineNumber;
+}
+
+void AdvisorMain::runCommand(const std::string& command, size_t lineNumber, std::ostream& output, BatchFormat format) {
+	std::shared_lock<std::shared_mutex> view = readLock(); // a followed book does not change while a command runs
+	if (format == BatchFormat::text) { // answers are written straight to the output, exactly as the interactive mode prints them
+		out = &output;
+		processUserOption(command);
+		return;
+	}
+
+	answer.str(""); // the answer is collected, then written as one record
+	out = &answer;
+	processUserOption(command);
+
+	answerLines.clear();
+	const std::string& text = answer.str();
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos) end = text.size();
+		answerLines.push_back(text.substr(start, end - start));
+		start = end + 1;
+	}
+	writeRecord(output, format, lineNumber, command, answerLines);
+}
+
+std::shared_lock<std::shared_mutex> AdvisorMain::readLock() {
+	if (!liveDay) {
+		return std::shared_lock<std::shared_mutex>{};
+	}
+	return liveDay->readLock();
+}
+
+void AdvisorMain::writeRecord(std::ostream& output, BatchFormat format, size_t lineNumber, const std::string& command, const std::vector<std::string>& answerLines) {
+	if (format == BatchFormat::tsv) { // line, command, answer lines separated by \n, with tabs, newlines and backslashes escaped
+		output << lineNumber << '\t';
+		writeEscaped(output, command, false);
+		output << '\t';
+		for (size_t i = 0; i < answerLines.size(); i++) {
+			if (i > 0) output << "\\n";
+			writeEscaped(output, answerLines[i], false);
+		}
+		output << '\n';
+	} else { // {"line":1,"command":"prod","output":["ETH/BTC, ..."]}
+		output << "{\"line\":" << lineNumber << ",\"command\":\"";
+		writeEscaped(output, command, true);
+		output << "\",\"output\":[";
+		for (size_t i = 0; i < answerLines.size(); i++) {
+			if (i > 0) output << ',';
+			output << '"';
+			writeEscaped(output, answerLines[i], true);
+			output << '"';
+		}
+		output << "]}\n";
+	}
+}
+
+void AdvisorMain::writeEscaped(std::ostream& output, const std::string& text, bool json) {
+	for (char c : text) {
+		switch (c) {
+			case '\\': output << "\\\\"; break;
+			case '\t': output << "\\t"; break;
+			case '\n': output << "\\n"; break;
+			case '\r': output << "\\r"; break;
+			case '"':
+				if (json) output << "\\\"";
+				else output << c;
+				break;
+			default:
+				if (json && static_cast<unsigned char>(c) < 0x20) { // other control characters as \u00XX
+					const char* digits = "0123456789abcdef";
+					output << "\\u00" << digits[(c >> 4) & 0xf] << digits[c & 0xf];
+				} else {
+					output << c;
+				}
+		}
+	}
+}
+
+void AdvisorMain::stripCarriageReturn(std::string& line) { // command files written on Windows end their lines with \r\n
+	if (!line.empty() && line.back() == '\r') line.pop_back();
+}
+
+void AdvisorMain::printMenu() { // prints introduction to the advisorbot when the program first initializes
+	*out << "Welcome to Advisorbot. Advisorbot is a command line program that can carry out various" << "\n";
+	*out << "tasks to help a cryptocurrency investor analyse the data available on an exchange." << "\n";
+	*out << "======================================================================================" << "\n";
+	*out << "To begin, please enter a command, or type 'help' for a list of commands" << "\n";
+}
+
+void AdvisorMain::printHelp(const CommandTokens& userOptionLine) { //print help function, when prints all available commands, and also prints each command's use and purpose
+	std::string_view topic = userOptionLine.size() == 2 ? userOptionLine[1] : std::string_view{}; // 'help <cmd>'
+	if (userOptionLine.size() == 1) {
+		*out << "The available commands are: help, help <cmd>, prod, min, max, avg, predict, liquidity, time, step <no>, stats, bid, ask, orders, cancel, sales, depth, fill, imbalance, goto <time>, summary" << "\n";
+		*out << "======================================================================================================" << "\n";
+	} else if (topic == "prod") {
+		*out << "Command: prod" << "\n";
+		*out << "Purpose: List all available products." << "\n";
+		*out << "Example: user> help prod" << "\n";
+		*out << "         advisorbot> ETH/BTC, DOGE/BTC etc." << "\n";
+	} else if (topic == "min") {
+		*out << "Command: min product bid/ask <from time to time>" << "\n";
+		*out << "Purpose: Find the minimum bid or ask for product in current time step, or over the time steps from one time to another." << "\n";
+		*out << "         A time is hh:mm:ss on the current day or yyyy/mm/dd hh:mm:ss, with up to 6 digits of seconds after a '.'" << "\n";
+		*out << "Example: user> min ETH/BTC ask" << "\n";
+		*out << "         advisorbot> The min ask for ETH/BTC is 0.0248261" << "\n";
+		*out << "Example: user> min ETH/BTC ask from 12:00:00 to 12:05:00" << "\n";
+		*out << "         advisorbot> The min ask for ETH/BTC from 2020/06/01 12:00:00.477522 to 2020/06/01 12:04:57.607385 (100 timesteps) is 0.0245339" << "\n";
+	} else if (topic == "max") {
+		*out << "Command: max product bid/ask <from time to time>" << "\n";
+		*out << "Purpose: Find the maximum bid or ask for product in current time step, or over the time steps from one time to another (see help min)" << "\n";
+		*out << "Example: user> max ETH/BTC ask" << "\n";
+		*out << "         advisorbot> The max ask for ETH/BTC is 0.0251581" << "\n";
+	} else if (topic == "avg") {
+		*out << "Command: avg product ask/bid timesteps, or avg product ask/bid from time to time" << "\n";
+		*out << "Purpose: Compute the average ask or bid for the sent product over the sent number of time steps, or over the time steps from one time to another (see help min)" << "\n";
+		*out << "Example: user> avg ETH/BTC ask 10" << "\n";
+		*out << "         advisorbot> The average ETH/BTC ask price over the last 10 timesteps was 0.0249612" << "\n";
+	} else if (topic == "predict") {
+		*out << "Command: predict max/min product ask/bid <period> <ema/sma>" << "\n";
+		*out << "Purpose: Predict the max or min ask or bid for the sent product for the next time step, using a moving average over period timesteps (4 and ema by default)" << "\n";
+		*out << "         Requires user to be at minimum on the timestamp equal to the period" << "\n";
+		*out << "Example: user> predict max BTC/USDT bid" << "\n";
+		*out << "         advisorbot> The predicted max ask price for ETH/BTC is 0.0222814 for the next time frame" << "\n";
+	} else if (topic == "liquidity") {
+		*out << "Command: liquidity product <timesteps>" << "\n";
+		*out << "Purpose: Averages the liquidity of product for the past timesteps (10 by default), uses bid-ask spread as the measure" << "\n";
+		*out << "Example: user> liquidity DOGE/BTC" << "\n";
+		*out << "         advisorbot> The average liquidity of DOGE/BTC for the previous 10 steps is 4.07% (min 3.1%, max 5.2%)" << "\n";
+	} else if (topic == "time") {
+		*out << "Command: time" << "\n";
+		*out << "Purpose: State current time in dataset, i.e. which timeframe are we looking at" << "\n";
+		*out << "Example: user> time" << "\n";
+		*out << "         advisorbot> Current time is 2020/03/17 17:01:24, timestamp: 5" << "\n";
+	} else if (topic == "summary") {
+		*out << "Command: summary <timesteps>" << "\n";
+		*out << "Purpose: Show the orders, min, max, mean and volume weighted average price of the asks and bids of every product," << "\n";
+		*out << "         and its average bid-ask spread in %, over the past timesteps (just the current time step by default)" << "\n";
+		*out << "Example: user> summary 10" << "\n";
+		*out << "         advisorbot> Summary of the last 10 timesteps, 2020/06/01 11:57:00.140891 to 2020/06/01 11:57:24.698309" << "\n";
+		*out << "                     product    side  orders  min  max  mean  vwap  spread %" << "\n";
+	} else if (topic == "goto") {
+		*out << "Command: goto time" << "\n";
+		*out << "Purpose: Moves to the first time step at or after time, hh:mm:ss on the current day or yyyy/mm/dd hh:mm:ss." << "\n";
+		*out << "         Open orders are not matched at the time steps it jumps over" << "\n";
+		*out << "Example: user> goto 12:03:00" << "\n";
+		*out << "         advisorbot> Now at 2020/06/01 12:03:00.589773" << "\n";
+	} else if (topic == "step") {
+		*out << "Command: step <no.>" << "\n";
+		*out << "Purpose: Moves to the next specified amount of timesteps, defaults to 1" << "\n";
+		*out << "Example: user> step" << "\n";
+		*out << "         advisorbot> Now at 2020/03/17 17:01:30" << "\n";
+	} else if (topic == "stats") {
+		*out << "Command: stats" << "\n";
+		*out << "Purpose: Show how long each command took (p50, p90, p99 and max), the rows and timesteps it went through, and how long loading the data took" << "\n";
+		*out << "Example: user> stats" << "\n";
+		*out << "         advisorbot> min: 12 runs, latency p50 0.9 us, p90 1.2 us, p99 2.0 us, max 2.3 us, per run 0.0 rows scanned, 0.0 rows copied, 1.0 timesteps traversed" << "\n";
+	} else if (topic == "bid" || topic == "ask") {
+		*out << "Command: bid/ask product price amount" << "\n";
+		*out << "Purpose: Place an order to buy (bid) or sell (ask) amount of product at price or better. It is matched against the orders of the current time step," << "\n";
+		*out << "         and what is left of it is matched again at every time step you step through until it is filled or cancelled" << "\n";
+		*out << "Example: user> bid ETH/BTC 0.0249 2" << "\n";
+		*out << "         advisorbot> Order 1: bid 2 ETH/BTC at 0.0249" << "\n";
+		*out << "                     Order 1 bought 0.5 ETH/BTC at 0.02487" << "\n";
+	} else if (topic == "orders") {
+		*out << "Command: orders" << "\n";
+		*out << "Purpose: List your open orders and how much of them was filled" << "\n";
+		*out << "Example: user> orders" << "\n";
+		*out << "         advisorbot> Order 1: bid 2 ETH/BTC at 0.0249, filled 0.5, open 1.5" << "\n";
+	} else if (topic == "cancel") {
+		*out << "Command: cancel id" << "\n";
+		*out << "Purpose: Cancel what is left of one of your open orders" << "\n";
+		*out << "Example: user> cancel 1" << "\n";
+		*out << "         advisorbot> Order 1 cancelled" << "\n";
+	} else if (topic == "sales") {
+		*out << "Command: sales product" << "\n";
+		*out << "Purpose: Match the bids and asks of product in the current time step at price-time priority and sum up the sales" << "\n";
+		*out << "Example: user> sales ETH/BTC" << "\n";
+		*out << "         advisorbot> 12 sales of ETH/BTC in this time step, 31.4 traded at 0.02471 to 0.02489" << "\n";
+	} else if (topic == "depth") {
+		*out << "Command: depth product percent" << "\n";
+		*out << "Purpose: Sum the amounts bid and asked for product in current time step at prices within percent % of the mid price" << "\n";
+		*out << "Example: user> depth ETH/BTC 1" << "\n";
+		*out << "         advisorbot> Within 1% of the mid price 0.0247802 of ETH/BTC there are 152.3 bid over 14 prices and 98.7 asked over 11 prices" << "\n";
+	} else if (topic == "fill") {
+		*out << "Command: fill product bid/ask size" << "\n";
+		*out << "Purpose: Find the price a bid (buy) or ask (sell) of size would fill at against the orders of product in current time step" << "\n";
+		*out << "Example: user> fill ETH/BTC bid 50" << "\n";
+		*out << "         advisorbot> A bid of 50 ETH/BTC fills at an average of 0.0248403, up to 0.0248911" << "\n";
+	} else if (topic == "imbalance") {
+		*out << "Command: imbalance product <percent>" << "\n";
+		*out << "Purpose: Compare the amounts bid and asked for product in current time step, over the whole book or within percent % of the mid price." << "\n";
+		*out << "         From -1 when there are only asks to 1 when there are only bids" << "\n";
+		*out << "Example: user> imbalance ETH/BTC" << "\n";
+		*out << "         advisorbot> The book imbalance of ETH/BTC is 0.21 (184.2 bid, 120.4 asked)" << "\n";
+	} else { // if none of the above was matched, returns invalid input statement and tells user to type help for all valid commands
+		*out << "Invalid input. Type 'help' to display all valid commands" << "\n";
+	}
+}
+
+void AdvisorMain::printProducts(const CommandTokens& userOptionLine) { // 'prod' command, prints out all available products in the dataset
+	if (userOptionLine.size() != 1) {
+		*out << "Invalid input. Type 'help' to display all valid commands" << "\n";
+		return;
+	}
+	bool first = true;
+	*out << "Known products: " << "";
+	for (std::string const& p : book->getKnownProducts()) { // Gets all known products from the orderbook using getKnownProducts function
+		if (!first) {
+			*out << "," << p << ""; // separates the products with commas to be printed
+		} else {
+			*out << p << "";
+			first = false;
+		}
+	}
+	*out << "\n";
+}
+
+void AdvisorMain::printMinMax(const CommandTokens& userOptionLine) { // Minimum / Maximum command which returns the min/max as/bid of the product the user has input 
+
+	if (userOptionLine.size() > 3 && userOptionLine[3] == "from") { // 'min/max product ask/bid from <time> to <time>'
+		printTimeRangeStats(userOptionLine);
+	} else if (userOptionLine.size() != 3) { // user input must be a line which can be separated into 3 individual strings
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+	} else {
+
+		std::string_view type = userOptionLine[2];
+		std::string_view product = userOptionLine[1];
+
+		if (product.substr(0, 4) == "DOGE") { // Changing precision when printing DOGE products to show more accurately their value rather than scientific notations
+			out->precision(10);
+			*out << std::fixed;
+		}
+		else { // If user is analysing other products, change back the precision to the default
+			out->precision(-1);
+			*out << std::defaultfloat;
+		}
+
+		size_t productIndex = book->getProductIndex(product); // hash lookup in the product catalog of the day
+		if ((type != "bid" && type != "ask") || productIndex == book->getKnownProducts().size()) { // the input must name bid/ask and a known product
+			*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+			return;
+		}
+		OrderBookType orderType = type == "bid" ? OrderBookType::bid : OrderBookType::ask; // the min/max comes from the aggregate table of the bid/ask which the user input
+		const OrderStats& stats = book->getStats(orderType, productIndex, currentStep);
+		if (stats.count == 0) { //if entries for product is empty, print out line
+			*out << "This product has no entries" << "\n";
+		}
+		else if (userOptionLine[0] == "min") { // matches if the user wanted to search for min
+			*out << "The min " << type << " for " << product << " is " << stats.min << "\n";
+		}
+		else { // the dispatch table only sends min and max here
+			*out << "The max " << type << " for " << product << " is " << stats.max << "\n";
+		}
+	}
+
+}
+
+void AdvisorMain::printAvg(const CommandTokens& userOptionLine) { // Average command. Averages the ask/bid of a product for the x past numbers of timesteps
+
+	// variables needed for the average function
+	double avg = 0;
+	unsigned int timesteps; // How many past timesteps (including current) the user wants to average
+	size_t userTimeStamp; // Which timestamp the user is current at
+
+	if (userOptionLine.size() > 3 && userOptionLine[3] == "from") { // 'avg product ask/bid from <time> to <time>'
+		printTimeRangeStats(userOptionLine);
+	}
+	else if (userOptionLine.size() != 4) { // user input must be a line which can be separated into 4 individual strings from a vector
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+	}
+	else {
+		std::string_view type = userOptionLine[2];
+		std::string_view product = userOptionLine[1];
+
+		int sentTimesteps;
+		if (!parseNumber(userOptionLine[3], sentTimesteps)) { // convert user's input from string to int
+			*out << "Please input a number for your timesteps" << "\n";
+			return; // If user inputs non int for timestep value, return without executing any more code
+		}
+		if (sentTimesteps <= 0) { // checked before the conversion, a negative count would turn into a huge one
+			*out << "Please enter a number greater than 0" << "\n";
+			return;
+		}
+		timesteps = sentTimesteps;
+
+		if (type != "ask" && type != "bid") { // validation to check if user inputed a valid type
+			*out << "Wrong line input, please check order of commands" << "\n";
+			return;
+		}
+
+		if (product.substr(0, 4) == "DOGE") { // Changing precision when printing DOGE products to show more accurately their value rather than scientific notations
+			out->precision(10);
+			*out << std::fixed;
+		}
+		else { // If user is analysing other products, change back the precision to the default
+			out->precision(-1);
+			*out << std::defaultfloat;
+		}
+
+		std::pmr::vector<DaySegment> window = catalog.getWindow(currentDay, currentStep, timesteps, &scratch); // the timesteps may reach back into earlier days
+		userTimeStamp = windowLength(window);
+
+		if (timesteps > userTimeStamp) { // validation if the user inputs more timesteps to analyse than there are up to the current timestamp
+			*out << "You entered a greater number of timesteps to your current timestamp, please enter a timestep equal or less than your timestamp" << "\n";
+			return;
+		}
+
+		size_t productIndex = book->getProductIndex(product); // hash lookup in the product catalog of the day
+		if (productIndex == book->getKnownProducts().size()) {
+			*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+			return;
+		}
+
+		// the average past x timestamps is the mean of each timestep's average price, read from the range index without moving the cursor
+		OrderBookType orderType = type == "bid" ? OrderBookType::bid : OrderBookType::ask;
+		if (window.size() == 1) {
+			avg = window[0].book->getRangeStats(orderType, window[0].book->getProductIndex(product), window[0].firstStep, window[0].lastStep).averageOfAverages;
+		} else { // each day's mean weighted by its timesteps, a day without the product counts as 0 like an empty timestep
+			double sumOfAverages = 0;
+			for (const DaySegment& segment : window) {
+				RangeStats range = segment.book->getRangeStats(orderType, segment.book->getProductIndex(product), segment.firstStep, segment.lastStep);
+				sumOfAverages += range.averageOfAverages * range.timesteps;
+			}
+			avg = sumOfAverages / timesteps;
+		}
+
+		*out << "The average " << product << " " << type << " price over the last " << timesteps << " timesteps was " << avg << "\n";
+	}
+
+}
+
+
+void AdvisorMain::printTimeRangeStats(const CommandTokens& userOptionLine) { // min, max or avg over the timesteps between two times, found by binary search in each day
+
+	//min/max/avg product ask/bid from <time> to <time>
+	//     0         1       2     3     4     5    6
+	std::string_view type = userOptionLine[2];
+	std::string_view product = userOptionLine[1];
+	int64_t from, to;
+	if ((type != "bid" && type != "ask") || !parseTimeRange(userOptionLine, 3, from, to)) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	if (book->getProductIndex(product) == book->getKnownProducts().size()) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	std::pmr::vector<DaySegment> range = catalog.getTimeRange(from, to, &scratch);
+	if (range.empty()) {
+		*out << "There are no timesteps from " << Timestamp::format(from) << " to " << Timestamp::format(to) << "\n";
+		return;
+	}
+
+	// the range index answers each day's part, which are then combined like the days of avg
+	OrderBookType orderType = type == "bid" ? OrderBookType::bid : OrderBookType::ask;
+	double min = 0, max = 0, sumOfAverages = 0;
+	size_t count = 0;
+	for (const DaySegment& segment : range) {
+		size_t productIndex = segment.book->getProductIndex(product);
+		if (productIndex == segment.book->getKnownProducts().size()) continue; // a day without the product counts as empty timesteps
+		RangeStats stats = segment.book->getRangeStats(orderType, productIndex, segment.firstStep, segment.lastStep);
+		sumOfAverages += stats.averageOfAverages * stats.timesteps;
+		if (stats.count == 0) continue;
+		min = count == 0 ? stats.min : std::min(min, stats.min);
+		max = count == 0 ? stats.max : std::max(max, stats.max);
+		count += stats.count;
+	}
+	size_t timesteps = windowLength(range);
+
+	usePrecisionOf(product);
+	*out << (userOptionLine[0] == "avg" ? "The average " : userOptionLine[0] == "min" ? "The min " : "The max ");
+	if (userOptionLine[0] == "avg") {
+		*out << product << " " << type << " price";
+	} else {
+		*out << type << " for " << product;
+	}
+	char first[Timestamp::formattedLength], last[Timestamp::formattedLength]; // formatted on the stack, the answer does not allocate
+	Timestamp::format(range.front().book->getTime(range.front().firstStep), first);
+	Timestamp::format(range.back().book->getTime(range.back().lastStep), last);
+	*out << " from " << std::string_view{first, sizeof(first)} << " to " << std::string_view{last, sizeof(last)} << " (" << timesteps << " timesteps)";
+	if (userOptionLine[0] == "avg") {
+		*out << " was " << sumOfAverages / timesteps << "\n";
+	} else if (count == 0) {
+		*out << " has no entries" << "\n";
+	} else {
+		*out << " is " << (userOptionLine[0] == "min" ? min : max) << "\n";
+	}
+}
+
+
+void AdvisorMain::printPredict(const CommandTokens& userOptionLine) { // Predict function uses a moving average of the past timesteps to predict the next min/max ask/bid for the product
+
+	//variables needed for the function
+	unsigned int period = 4; // Using 4 step moving average as predictor unless the user sends a period
+	std::string_view method = "ema";
+
+	//predict max/min product ask/bid [period] [ema/sma]
+	//   0	     1	     2	     3        4         5
+	// EMA = Current price * (2/(period+1)) + EMA of previous step * (1 - 2/(period+1))
+
+	if (userOptionLine.size() < 4 || userOptionLine.size() > 6) { // user input must be a line which can be separated into 4 to 6 individual strings
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	if (userOptionLine.size() >= 5) {
+		int sentPeriod;
+		if (!parseNumber(userOptionLine[4], sentPeriod)) {
+			*out << "Please input a number for your period" << "\n";
+			return;
+		}
+		if (sentPeriod <= 0) {
+			*out << "Please enter a period greater than 0" << "\n";
+			return;
+		}
+		period = sentPeriod;
+	}
+	if (userOptionLine.size() == 6) {
+		method = userOptionLine[5];
+		if (method != "ema" && method != "sma") {
+			*out << "Wrong line input, the average can be ema or sma" << "\n";
+			return;
+		}
+	}
+
+	std::pmr::vector<DaySegment> window{&scratch}; // only needed when the period reaches back into earlier days
+	if (currentStep + 1 < period) {
+		window = catalog.getWindow(currentDay, currentStep, period, &scratch);
+	}
+	if (currentStep + 1 < period && windowLength(window) < period) { // the average needs a full period of timesteps up to the current one
+		*out << "Predict with a period of " << period << " can only be used on timestamp " << period << " onwards as it uses historical data" << "\n";
+	} else {
+
+		std::string_view type = userOptionLine[3];
+		std::string_view product = userOptionLine[2];
+		std::string_view minmax = userOptionLine[1];
+
+		// validation for ask/bid and min/max if they are input in the correct order of commands
+		if (type != "ask" && type != "bid") {
+			*out << "Wrong line input, please check order of commands" << "\n";
+			return;
+		}
+		else if (minmax != "max" && minmax != "min") {
+			*out << "Wrong line input, please check order of commands" << "\n";
+			return;
+		}
+
+		if (product.substr(0, 4) == "DOGE") { // Changing precision when printing DOGE products to show more accurately their value rather than scientific notations
+			out->precision(10);
+			*out << std::fixed;
+		}
+		else { // If user is analysing other products, change back the precision to the default
+			out->precision(-1);
+			*out << std::defaultfloat;
+		}
+
+		size_t productIndex = book->getProductIndex(product); // hash lookup in the product catalog of the day
+		if (productIndex == book->getKnownProducts().size()) {
+			*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+			return;
+		}
+
+		// the indicator engine keeps the averages of earlier calls, so only timesteps it has not seen yet are read
+		OrderBookType orderType = type == "bid" ? OrderBookType::bid : OrderBookType::ask;
+		PriceStat stat = minmax == "min" ? PriceStat::low : PriceStat::high;
+		double prediction;
+		if (window.empty()) {
+			prediction = method == "sma" ? indicators->getSMA(productIndex, orderType, stat, period, currentStep)
+										 : indicators->getEMA(productIndex, orderType, stat, period, currentStep);
+		} else { // across days the same averages run over the window the catalog put together
+			prediction = method == "sma" ? IndicatorEngine::getSMA(window, product, orderType, stat, period)
+										 : IndicatorEngine::getEMA(window, product, orderType, stat, period);
+		}
+		*out << "The " << minmax << " " << type << " for " << product << " might be " << prediction << " for the next timestep" << "\n";
+	}
+
+}
+
+void AdvisorMain::printLiquidity(const CommandTokens& userOptionLine) { // Liquidity function takes the product's average bid-ask spread of the previous steps in %, 10 by default
+
+	// variables needed for liquidty function
+	unsigned int timesteps = 10; // Using 10 step average of liquidity% unless the user sends a window
+
+	//liquidity product [timesteps]
+	//   0	       1          2
+	// Bid ask spread = min ask - max bid
+	// Liquidity % = (bid ask spread / lowest ask price)* 100
+
+	if (userOptionLine.size() != 2 && userOptionLine.size() != 3) { // user input must be a line which can be separated into 2 or 3 individual strings
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	if (userOptionLine.size() == 3) {
+		int sentTimesteps;
+		if (!parseNumber(userOptionLine[2], sentTimesteps)) {
+			*out << "Please input a number for your timesteps" << "\n";
+			return;
+		}
+		if (sentTimesteps <= 0) {
+			*out << "Please enter a number greater than 0" << "\n";
+			return;
+		}
+		timesteps = sentTimesteps;
+	}
+
+	std::pmr::vector<DaySegment> window = catalog.getWindow(currentDay, currentStep, timesteps, &scratch); // the window may reach back into earlier days
+	if (windowLength(window) < timesteps) { // User has to be on the timestamp equal to the window onwards to use this function
+		*out << "Liquidity over " << timesteps << " steps can only be used on timestamp " << timesteps << " onwards as it uses historical data" << "\n";
+	}
+	else {
+
+		std::string_view product = userOptionLine[1];
+
+		if (product.substr(0, 4) == "DOGE") { // Changing precision when printing DOGE products to show more accurately their value rather than scientific notations
+			out->precision(10);
+			*out << std::fixed;
+		}
+		else { // If user is analysing other products, change back the precision to the default
+			out->precision(-1);
+			*out << std::defaultfloat;
+		}
+
+		if (book->getProductIndex(product) == book->getKnownProducts().size()) { // hash lookup in the product catalog of the day
+			*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+			return;
+		}
+
+		// the spread series is computed once when the book loads, the window is answered from its prefix sums and trees
+		SpreadStats spread;
+		for (const DaySegment& segment : window) { // days are combined weighted by their quoted timesteps
+			SpreadStats day = segment.book->getSpreadStats(segment.book->getProductIndex(product), segment.firstStep, segment.lastStep);
+			if (day.timesteps == 0) continue;
+			if (spread.timesteps == 0) {
+				spread = day;
+				continue;
+			}
+			size_t quoted = spread.timesteps + day.timesteps;
+			spread.meanSpread = (spread.meanSpread * spread.timesteps + day.meanSpread * day.timesteps) / quoted;
+			spread.meanRelativeSpread = (spread.meanRelativeSpread * spread.timesteps + day.meanRelativeSpread * day.timesteps) / quoted;
+			spread.minSpread = std::min(spread.minSpread, day.minSpread);
+			spread.maxSpread = std::max(spread.maxSpread, day.maxSpread);
+			spread.minRelativeSpread = std::min(spread.minRelativeSpread, day.minRelativeSpread);
+			spread.maxRelativeSpread = std::max(spread.maxRelativeSpread, day.maxRelativeSpread);
+			spread.timesteps = quoted;
+		}
+		if (spread.timesteps == 0) {
+			*out << "This product has no bids and asks in the previous " << timesteps << " steps" << "\n";
+		} else {
+			*out << std::setprecision(2) << "The average liquidity of " << product << " for the previous " << timesteps << " steps is " << spread.meanRelativeSpread << "%"
+					  << " (min " << spread.minRelativeSpread << "%, max " << spread.maxRelativeSpread << "%)" << "\n";
+		}
+	}
+
+}
+
+void AdvisorMain::printStats(std::ostream& output) { // 'stats' command, latency and work per command, then the phases of loading the current day
+	commandStats->print(output);
+	const LoadTimings& load = book->getLoadTimings();
+	std::ios::fmtflags flags = output.flags();
+	std::streamsize precision = output.precision();
+	output << std::fixed << std::setprecision(1);
+	output << "Loaded " << catalog.getDayFile(currentDay) << (load.fromBlockFile ? " from its block file" : load.fromSnapshot ? " from its snapshot" : "") << " in " << load.total << " ms: read " << load.read
+		   << " ms, parse " << load.parse << " ms, index " << load.index << " ms, aggregates " << load.aggregates << " ms, range index " << load.rangeIndex
+		   << " ms, spread index " << load.spreadIndex << " ms, depth index " << load.depthIndex << " ms, snapshot write " << load.snapshotWrite << " ms" << "\n";
+	if (book->isOutOfCore()) { // the blocks decoded since the day loaded, by the load and every command
+		BlockCacheCounters blocks = book->getBlockCounters();
+		output << "Out of core (block file written in " << load.blockWrite << " ms): " << blocks.residentBytes / (1024.0 * 1024.0) << " MB of blocks decoded, "
+			   << blocks.loads << " block loads, " << blocks.hits << " hits, " << blocks.readaheads << " read ahead, " << blocks.evictions << " evicted" << "\n";
+		if (blocks.encodedBytes > 0) {
+			output << std::setprecision(2) << "Compression ratio " << static_cast<double>(blocks.decodedBytes) / static_cast<double>(blocks.encodedBytes)
+				   << std::setprecision(1) << ": " << blocks.encodedBytes / (1024.0 * 1024.0) << " MB read and decoded into " << blocks.decodedBytes / (1024.0 * 1024.0)
+				   << " MB at " << blocks.decodedBytes / (1024.0 * 1024.0) / std::max(blocks.decodeSeconds, 1e-9) << " MB/s" << "\n";
+		}
+	}
+	output.flags(flags);
+	output.precision(precision);
+}
+
+void AdvisorMain::printTime(const CommandTokens& userOptionLine) { // Displays current time frame
+	if (userOptionLine.size() != 1) {
+		*out << "Invalid input. Type 'help' to display all valid commands" << "\n";
+		return;
+	}
+	*out << "Current time is " << book->getTimestamp(currentStep) << " Timestamp: " << currentStep + 1;
+	if (catalog.getDayCount() > 1) {
+		*out << " of day " << currentDay + 1;
+	}
+	*out << "\n";
+}
+
+void AdvisorMain::printCommandStats(const CommandTokens& userOptionLine) { // Displays command latencies and load timings
+	if (userOptionLine.size() != 1) {
+		*out << "Invalid input. Type 'help' to display all valid commands" << "\n";
+		return;
+	}
+	printStats(*out);
+}
+
+void AdvisorMain::gotoNextTimeFrame(const CommandTokens& userOptionLine) {
+	int steps = 1; // 'step' defaults to advancing 1 time step. If unsigned int is used, user inputting negative number will crash the program
+	if (userOptionLine.size() > 2 || (userOptionLine.size() == 2 && !parseNumber(userOptionLine[1], steps))) { // validation
+		*out << "Invalid input. Type 'help' to display all valid commands" << "\n";
+		return;
+	}
+	if (steps <= 0) { // 'step <no>' users can type how many steps they want to advance, the cursor wraps around to the start
+		*out << "Please enter a step greater than 0" << "\n";
+		return;
+	}
+	// open orders are matched at every timestep passed, until they are filled or the cursor has been round the whole timeline,
+	// after which the same orders only come again
+	while (steps > 0 && matching.getLiveOrderCount() > 0) {
+		moveForward(1);
+		steps--;
+		matching.matchTimestep(*book, currentStep);
+		printUserSales(0);
+		if (currentDay == 0 && currentStep == 0) break;
+	}
+	moveForward(steps);
+	*out << "Now at " << book->getTimestamp(currentStep) << "\n";
+}
+
+void AdvisorMain::printSummary(const CommandTokens& userOptionLine) { // one table of every product and side, read from the range and spread indexes
+
+	//summary [timesteps]
+	//   0        1
+	int timesteps = 1;
+	if (userOptionLine.size() > 2 || (userOptionLine.size() == 2 && !parseNumber(userOptionLine[1], timesteps))) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	if (timesteps <= 0) {
+		*out << "Please enter a number greater than 0" << "\n";
+		return;
+	}
+	std::pmr::vector<DaySegment> window = catalog.getWindow(currentDay, currentStep, timesteps, &scratch); // the window may reach back into earlier days
+	if (windowLength(window) < static_cast<size_t>(timesteps)) {
+		*out << "A summary over " << timesteps << " steps can only be used on timestamp " << timesteps << " onwards as it uses historical data" << "\n";
+		return;
+	}
+
+	char first[Timestamp::formattedLength], last[Timestamp::formattedLength];
+	Timestamp::format(window.front().book->getTime(window.front().firstStep), first);
+	Timestamp::format(window.back().book->getTime(window.back().lastStep), last);
+	*out << "Summary of the last " << timesteps << " timesteps, " << std::string_view{first, sizeof(first)} << " to " << std::string_view{last, sizeof(last)} << "\n";
+	*out << std::left << std::setw(12) << "product" << std::setw(6) << "side" << std::right << std::setw(10) << "orders" << std::setw(14) << "min"
+		 << std::setw(14) << "max" << std::setw(14) << "mean" << std::setw(14) << "vwap" << std::setw(11) << "spread %" << "\n";
+	out->precision(6);
+	*out << std::defaultfloat;
+
+	// each product and side is a handful of lookups in the indexes built when the days loaded, however long the window is
+	for (const std::string& product : book->getKnownProducts()) {
+		SpreadStats spread;
+		for (OrderBookType orderType : {OrderBookType::ask, OrderBookType::bid}) {
+			RangeStats stats; // the days of the window combined, min and max over the days that had orders
+			for (const DaySegment& segment : window) {
+				size_t productIndex = segment.book->getProductIndex(product);
+				if (productIndex == segment.book->getKnownProducts().size()) continue;
+				RangeStats day = segment.book->getRangeStats(orderType, productIndex, segment.firstStep, segment.lastStep);
+				if (day.count > 0) {
+					stats.min = stats.count == 0 ? day.min : std::min(stats.min, day.min);
+					stats.max = stats.count == 0 ? day.max : std::max(stats.max, day.max);
+				}
+				stats.priceSum += day.priceSum;
+				stats.amountSum += day.amountSum;
+				stats.notional += day.notional;
+				stats.count += day.count;
+				if (orderType == OrderBookType::ask) { // the spread of the product, once
+					SpreadStats daySpread = segment.book->getSpreadStats(productIndex, segment.firstStep, segment.lastStep);
+					size_t quoted = spread.timesteps + daySpread.timesteps;
+					if (quoted == 0) continue;
+					spread.meanRelativeSpread = (spread.meanRelativeSpread * spread.timesteps + daySpread.meanRelativeSpread * daySpread.timesteps) / quoted;
+					spread.timesteps = quoted;
+				}
+			}
+
+			*out << std::left << std::setw(12) << (orderType == OrderBookType::ask ? product : "") << std::setw(6) << (orderType == OrderBookType::ask ? "ask" : "bid")
+				 << std::right << std::setw(10) << stats.count;
+			if (stats.count == 0) {
+				*out << std::setw(14) << "-" << std::setw(14) << "-" << std::setw(14) << "-" << std::setw(14) << "-";
+			} else {
+				*out << std::setw(14) << stats.min << std::setw(14) << stats.max << std::setw(14) << stats.priceSum / stats.count
+					 << std::setw(14) << (stats.amountSum > 0 ? stats.notional / stats.amountSum : 0);
+			}
+			if (orderType == OrderBookType::ask && spread.timesteps > 0) {
+				*out << std::setw(11) << spread.meanRelativeSpread;
+			} else if (orderType == OrderBookType::ask) {
+				*out << std::setw(11) << "-";
+			}
+			*out << "\n";
+		}
+	}
+}
+
+void AdvisorMain::gotoTime(const CommandTokens& userOptionLine) {
+	size_t position = 1;
+	int64_t time;
+	if (userOptionLine.size() < 2 || !parseTime(userOptionLine, position, Timestamp::startOfDay(book->getTime(currentStep)), time)
+		|| position != userOptionLine.size()) {
+		*out << "Invalid input. Type 'help' to display all valid commands" << "\n";
+		return;
+	}
+	size_t day, step;
+	if (!catalog.findTime(time, day, step)) {
+		*out << "There are no timesteps at or after " << Timestamp::format(time) << "\n";
+		return;
+	}
+	moveToDay(day); // a jump, the open orders wait at the timestep it lands on
+	currentStep = step;
+	*out << "Now at " << book->getTimestamp(currentStep) << "\n";
+}
+
+void AdvisorMain::usePrecisionOf(std::string_view product) { // DOGE prices are shown in fixed notation with 10 digits rather than in scientific notation
+	if (product.substr(0, 4) == "DOGE") {
+		out->precision(10);
+		*out << std::fixed;
+	} else {
+		out->precision(-1);
+		*out << std::defaultfloat;
+	}
+}
+
+void AdvisorMain::matchCurrentTimestep() {
+	if (!matching.isAt(*book, currentStep)) {
+		matching.matchTimestep(*book, currentStep);
+	}
+}
+
+void AdvisorMain::printUserSales(size_t firstSale) { // one line per user order that traded, with the amount and average price of its sales
+	const std::vector<Sale>& sales = matching.getSales();
+	for (size_t i = firstSale; i < sales.size(); i++) {
+		size_t id = sales[i].userOrder;
+		if (id == MatchingEngine::noOrder) continue;
+		bool printed = false;
+		for (size_t j = firstSale; j < i && !printed; j++) {
+			printed = sales[j].userOrder == id;
+		}
+		if (printed) continue;
+
+		double amount = 0, notional = 0;
+		for (size_t j = i; j < sales.size(); j++) {
+			if (sales[j].userOrder != id) continue;
+			amount += sales[j].amount;
+			notional += sales[j].amount * sales[j].price;
+		}
+		const UserOrder& order = matching.getUserOrders()[id];
+		usePrecisionOf(order.product);
+		*out << "Order " << id + 1 << (order.orderType == OrderBookType::bid ? " bought " : " sold ") << amount << " " << order.product
+			 << " at " << notional / amount << " (" << book->getTimestamp(currentStep) << ")" << "\n";
+	}
+}
+
+void AdvisorMain::placeOrder(const CommandTokens& userOptionLine) { // 'bid/ask product price amount', the order is matched at once and what is left of it rests in the book
+
+	//bid/ask product price amount
+	//   0      1      2     3
+	if (userOptionLine.size() != 4) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	double price, amount;
+	if (!parseNumber(userOptionLine[2], price) || !parseNumber(userOptionLine[3], amount)) {
+		*out << "Please input a number for your price and amount" << "\n";
+		return;
+	}
+	if (!(price > 0) || !(amount > 0)) {
+		*out << "Please enter a price and amount greater than 0" << "\n";
+		return;
+	}
+	std::string_view product = userOptionLine[1];
+	if (book->getProductIndex(product) == book->getKnownProducts().size()) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+
+	usePrecisionOf(product);
+	matchCurrentTimestep(); // the order arrives after the orders of the timestep
+	size_t firstSale = matching.getSales().size();
+	OrderBookType orderType = userOptionLine[0] == "bid" ? OrderBookType::bid : OrderBookType::ask;
+	size_t id = matching.submit(username, product, orderType, price, amount);
+	if (id == MatchingEngine::noOrder) {
+		*out << "The order could not be placed, " << product << " does not trade in this time step" << "\n";
+		return;
+	}
+	*out << "Order " << id + 1 << ": " << userOptionLine[0] << " " << amount << " " << product << " at " << price << "\n";
+	printUserSales(firstSale);
+	const UserOrder& order = matching.getUserOrders()[id];
+	if (order.amount > 0) {
+		*out << "Order " << id + 1 << " has " << order.amount << " open, it is matched again at every step until it is filled" << "\n";
+	}
+}
+
+void AdvisorMain::printOrders(const CommandTokens& userOptionLine) { // lists the orders that are still open
+	if (userOptionLine.size() != 1) {
+		*out << "Invalid input. Type 'help' to display all valid commands" << "\n";
+		return;
+	}
+	if (matching.getLiveOrderCount() == 0) {
+		*out << "You have no open orders" << "\n";
+		return;
+	}
+	const std::vector<UserOrder>& orders = matching.getUserOrders();
+	for (size_t id = 0; id < orders.size(); id++) {
+		if (orders[id].amount <= 0 || orders[id].cancelled) continue;
+		usePrecisionOf(orders[id].product);
+		*out << "Order " << id + 1 << ": " << (orders[id].orderType == OrderBookType::bid ? "bid " : "ask ") << orders[id].amount + orders[id].filled << " " << orders[id].product
+			 << " at " << orders[id].price << ", filled " << orders[id].filled << ", open " << orders[id].amount << "\n";
+	}
+}
+
+void AdvisorMain::cancelOrder(const CommandTokens& userOptionLine) {
+	int id;
+	if (userOptionLine.size() != 2 || !parseNumber(userOptionLine[1], id)) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	if (id <= 0 || !matching.cancel(static_cast<size_t>(id - 1))) { // ids are shown from 1
+		*out << "Order " << id << " is not open" << "\n";
+		return;
+	}
+	*out << "Order " << id << " cancelled" << "\n";
+}
+
+void AdvisorMain::printSales(const CommandTokens& userOptionLine) { // 'sales product', what the matching engine traded of product in the current timestep
+	if (userOptionLine.size() != 2) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	std::string_view product = userOptionLine[1];
+	size_t productIndex = book->getProductIndex(product);
+	if (productIndex == book->getKnownProducts().size()) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+
+	usePrecisionOf(product);
+	matchCurrentTimestep();
+	size_t count = 0;
+	double volume = 0, low = 0, high = 0;
+	for (const Sale& sale : matching.getSales()) {
+		if (sale.product != productIndex) continue;
+		low = count == 0 ? sale.price : std::min(low, sale.price);
+		high = count == 0 ? sale.price : std::max(high, sale.price);
+		volume += sale.amount;
+		count++;
+	}
+	if (count == 0) {
+		*out << "No bids and asks of " << product << " matched in this time step" << "\n";
+	} else {
+		*out << count << " sales of " << product << " in this time step, " << volume << " traded at " << low << " to " << high << "\n";
+	}
+}
+
+void AdvisorMain::printDepth(const CommandTokens& userOptionLine) { // 'depth product percent', answered from the depth ladder of the current timestep
+
+	//depth product percent
+	//   0     1       2
+	if (userOptionLine.size() != 3) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	double percent;
+	if (!parseNumber(userOptionLine[2], percent)) {
+		*out << "Please input a number for your percent" << "\n";
+		return;
+	}
+	if (!(percent >= 0) || percent == std::numeric_limits<double>::infinity()) {
+		*out << "Please enter a percent of 0 or more" << "\n";
+		return;
+	}
+	std::string_view product = userOptionLine[1];
+	size_t productIndex = book->getProductIndex(product);
+	if (productIndex == book->getKnownProducts().size()) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+
+	usePrecisionOf(product);
+	DepthStats depth = book->getDepthStats(productIndex, currentStep, percent);
+	if (depth.unreadable) {
+		*out << "The orders of this time step cannot be read from the block file" << "\n";
+		return;
+	}
+	if (depth.mid == 0) {
+		*out << "This product needs both bids and asks in this time step to have a mid price" << "\n";
+		return;
+	}
+	*out << "Within " << userOptionLine[2] << "% of the mid price " << depth.mid << " of " << product << " there are " << depth.bidVolume << " bid over " << depth.bidLevels
+		 << " prices and " << depth.askVolume << " asked over " << depth.askLevels << " prices" << "\n";
+}
+
+void AdvisorMain::printFill(const CommandTokens& userOptionLine) { // 'fill product bid/ask size', walks the cumulative depth of the other side by binary search
+
+	//fill product bid/ask size
+	//  0     1       2      3
+	if (userOptionLine.size() != 4) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	std::string_view product = userOptionLine[1];
+	std::string_view type = userOptionLine[2];
+	double size;
+	if (!parseNumber(userOptionLine[3], size)) {
+		*out << "Please input a number for your size" << "\n";
+		return;
+	}
+	if (!(size > 0)) {
+		*out << "Please enter a size greater than 0" << "\n";
+		return;
+	}
+	size_t productIndex = book->getProductIndex(product);
+	if ((type != "bid" && type != "ask") || productIndex == book->getKnownProducts().size()) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+
+	usePrecisionOf(product);
+	FillEstimate fill = book->getFillEstimate(type == "bid" ? OrderBookType::bid : OrderBookType::ask, productIndex, currentStep, size);
+	if (fill.unreadable) {
+		*out << "The orders of this time step cannot be read from the block file" << "\n";
+		return;
+	}
+	if (fill.filled == 0) {
+		*out << "There are no " << (type == "bid" ? "asks" : "bids") << " of " << product << " in this time step to fill against" << "\n";
+	} else if (!fill.complete) {
+		*out << "Only " << fill.filled << " " << product << " can be filled in this time step, at an average of " << fill.averagePrice << ", up to " << fill.limitPrice << "\n";
+	} else {
+		*out << (type == "bid" ? "A bid of " : "An ask of ") << userOptionLine[3] << " " << product << " fills at an average of " << fill.averagePrice << ", up to " << fill.limitPrice << "\n";
+	}
+}
+
+void AdvisorMain::printImbalance(const CommandTokens& userOptionLine) { // 'imbalance product [percent]', the whole book unless a percent from the mid is sent
+	if (userOptionLine.size() != 2 && userOptionLine.size() != 3) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+	double percent = std::numeric_limits<double>::infinity();
+	if (userOptionLine.size() == 3) {
+		if (!parseNumber(userOptionLine[2], percent)) {
+			*out << "Please input a number for your percent" << "\n";
+			return;
+		}
+		if (!(percent >= 0)) {
+			*out << "Please enter a percent of 0 or more" << "\n";
+			return;
+		}
+	}
+	std::string_view product = userOptionLine[1];
+	size_t productIndex = book->getProductIndex(product);
+	if (productIndex == book->getKnownProducts().size()) {
+		*out << "Wrong line input, type 'help <cmd>' for a valid command input" << "\n";
+		return;
+	}
+
+	usePrecisionOf(product);
+	DepthStats depth = book->getDepthStats(productIndex, currentStep, percent);
+	if (depth.unreadable) {
+		*out << "The orders of this time step cannot be read from the block file" << "\n";
+		return;
+	}
+	if (depth.bidVolume + depth.askVolume == 0) {
+		*out << "This product has no bids and asks " << (userOptionLine.size() == 3 ? "near the mid price " : "") << "in this time step" << "\n";
+		return;
+	}
+	out->precision(2);
+	*out << std::fixed << "The book imbalance of " << product << " is " << depth.imbalance;
+	usePrecisionOf(product);
+	*out << " (" << depth.bidVolume << " bid, " << depth.askVolume << " asked)" << "\n";
+}
+
+bool AdvisorMain::parseNumber(std::string_view text, int& number) { // the whole token must be the number, unlike stoi which stops at the first other character
+	const char* end = text.data() + text.size();
+	std::from_chars_result result = std::from_chars(text.data(), end, number);
+	return result.ec == std::errc{} && result.ptr == end;
+}
+
+bool AdvisorMain::parseNumber(std::string_view text, double& number) {
+	const char* end = text.data() + text.size();
+	std::from_chars_result result = std::from_chars(text.data(), end, number);
+	return result.ec == std::errc{} && result.ptr == end;
+}
+
+bool AdvisorMain::parseTime(const CommandTokens& tokens, size_t& position, int64_t base, int64_t& time) {
+	if (position >= tokens.size()) {
+		return false;
+	}
+	std::string_view first = tokens[position];
+	if (first.find('/') == std::string_view::npos) { // a time of day
+		if (!Timestamp::parseTimeOfDay(first, time)) return false;
+		time += base;
+		position++;
+		return true;
+	}
+	if (position + 1 >= tokens.size() || first.size() + 1 + tokens[position + 1].size() > 32) {
+		return false;
+	}
+	char text[32]; // the date and the time are two tokens, joined again on the stack
+	size_t length = first.copy(text, first.size());
+	text[length++] = ' ';
+	length += tokens[position + 1].copy(text + length, tokens[position + 1].size());
+	if (!Timestamp::parse(std::string_view{text, length}, time)) return false;
+	position += 2;
+	return true;
+}
+
+bool AdvisorMain::parseTimeRange(const CommandTokens& tokens, size_t position, int64_t& from, int64_t& to) const {
+	int64_t day = Timestamp::startOfDay(book->getTime(currentStep));
+	if (position >= tokens.size() || tokens[position] != "from") return false;
+	position++;
+	if (!parseTime(tokens, position, day, from)) return false;
+	if (position >= tokens.size() || tokens[position] != "to") return false;
+	position++;
+	return parseTime(tokens, position, day, to) && position == tokens.size();
+}
+
+bool AdvisorMain::getUserOption(std::string& userOption) { // Takes the user's input using cin, returns false when the input has ended
+	if (!std::getline(std::cin, userOption)) {
+		return false;
+	}
+	stripCarriageReturn(userOption);
+	return true;
+}
+
+CommandTokens AdvisorMain::userOptionTokenise(std::string_view userOption, std::pmr::memory_resource* resource) { // tokenise user's input into a vector of views into it
+	CommandTokens userOptionLine{resource};
+	signed int start, end;
+	start = userOption.find_first_not_of(" ", 0);
+	do {
+		end = userOption.find_first_of(" ", start);
+		if (start == static_cast<signed int>(userOption.length()) || start == end) break;
+		if (end >= 0) userOptionLine.push_back(userOption.substr(start, end - start));
+		else userOptionLine.push_back(userOption.substr(start, userOption.length() - start));
+		start = end + 1;
+	} while (end > 0);
+	return userOptionLine;
+}
+
+const AdvisorMain::CommandHandler AdvisorMain::commandTable[] = {
+	{"help", CommandStats::Command::help, &AdvisorMain::printHelp}, //Print all commands and their uses
+	{"prod", CommandStats::Command::prod, &AdvisorMain::printProducts}, // Displays all products
+	{"min", CommandStats::Command::minimum, &AdvisorMain::printMinMax}, // Displays min/max ask/bid for product
+	{"max", CommandStats::Command::maximum, &AdvisorMain::printMinMax},
+	{"avg", CommandStats::Command::average, &AdvisorMain::printAvg}, // Displays avg ask/bid for product
+	{"predict", CommandStats::Command::predict, &AdvisorMain::printPredict}, // Displays prediction for max/min product ask/bid using weighted moving avg
+	{"time", CommandStats::Command::time, &AdvisorMain::printTime}, // Displays current time frame
+	{"step", CommandStats::Command::step, &AdvisorMain::gotoNextTimeFrame}, // Progresses to the next time frame
+	{"liquidity", CommandStats::Command::liquidity, &AdvisorMain::printLiquidity},
+	{"stats", CommandStats::Command::stats, &AdvisorMain::printCommandStats}, // Displays command latencies and load timings
+	{"bid", CommandStats::Command::bid, &AdvisorMain::placeOrder}, // Submits an order of the user to the matching engine
+	{"ask", CommandStats::Command::ask, &AdvisorMain::placeOrder},
+	{"orders", CommandStats::Command::orders, &AdvisorMain::printOrders}, // Lists the user's open orders
+	{"cancel", CommandStats::Command::cancel, &AdvisorMain::cancelOrder},
+	{"sales", CommandStats::Command::sales, &AdvisorMain::printSales}, // Displays the sales the matching engine made in the current time frame
+	{"depth", CommandStats::Command::depth, &AdvisorMain::printDepth}, // Displays the volume bid and asked near the mid price
+	{"fill", CommandStats::Command::fill, &AdvisorMain::printFill}, // Displays the price an order of a size would fill at
+	{"imbalance", CommandStats::Command::imbalance, &AdvisorMain::printImbalance},
+	{"goto", CommandStats::Command::jump, &AdvisorMain::gotoTime}, // Moves to the first time frame at or after a time
+	{"summary", CommandStats::Command::summary, &AdvisorMain::printSummary} // Displays the statistics of every product in one table
+};
+
+const AdvisorMain::CommandHandler* AdvisorMain::findCommand(std::string_view name) { // a few commands, a linear scan of the names is as fast as any lookup
+	for (const CommandHandler& handler : commandTable) {
+		if (handler.name == name) return &handler;
+	}
+	return nullptr;
+}
+
+void AdvisorMain::processUserOption(const std::string& userOption) { // Splits the user's input into tokens, runs the handler of the first one and counts the time and work it took
+	QueryCounters before = OrderBook::getQueryCounters(); // the counters are per thread, and a command runs on one thread
+	auto start = std::chrono::steady_clock::now();
+	CommandStats::Command command = CommandStats::Command::invalid;
+	{
+		CommandTokens userOptionLine = userOptionTokenise(userOption, &scratch); // the tokens are views into userOption, no strings are copied
+		const CommandHandler* handler = userOptionLine.empty() ? nullptr : findCommand(userOptionLine[0]);
+		if (handler == nullptr) { //If none of the valid commands are typed, invalid input and prompts user to type help
+			*out << "Invalid input. Type 'help' to display all valid commands" << "\n";
+		} else {
+			command = handler->command;
+			(this->*handler->run)(userOptionLine);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	const QueryCounters& after = OrderBook::getQueryCounters();
+	QueryCounters work;
+	work.rowsScanned = after.rowsScanned - before.rowsScanned;
+	work.rowsCopied = after.rowsCopied - before.rowsCopied;
+	work.timestepsTraversed = after.timestepsTraversed - before.timestepsTraversed;
+	commandStats->record(command, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()), work);
+	scratch.release(); // the temporaries of the command go all at once, the next command starts again at the front of the buffer
+}
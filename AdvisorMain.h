@@ -1,33 +1,144 @@
-#pragma once
-#include <vector>
-#include "OrderBookEntry.h"
-#include "OrderBook.h"
-
-class AdvisorMain {
-
-	public:
-		AdvisorMain();
-		/** Call this to start the sim*/
-		void init();
-		static std::vector<std::string> userOptionTokenise(std::string userOption);
-		
-	private:
-		void printMenu();
-		void printHelp(std::string userOption);
-		void printProducts();
-		void printMinMax(std::string userOption);
-		void printAvg(std::string userOption);
-		void printPredict(std::string userOption);
-		void gotoNextTimeFrame(std::string userOption);
-		void gotoPrevTimeFrame();
-		std::string getUserOption();
-		void processUserOption(std::string userOption);
-		void printLiquidity(std::string userOption);
-		unsigned int timeStepsTaken; 
-
-		std::string currentTime;
-	
-		OrderBook orderBook{"20200601.csv"};
-
-};
-
+#pragma once
+#include <vector>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include "OrderBookEntry.h"
+#include "OrderBook.h"
+#include "IndicatorEngine.h"
+#include "MatchingEngine.h"
+#include "DatasetCatalog.h"
+#include "CommandStats.h"
+#include <shared_mutex>
+
+/** How runBatch writes the answers */
+enum class BatchFormat {
+	/** the answers as the interactive mode prints them */
+	text,
+	/** one line per command: line number, command and answer, tab separated. Lines of the answer are joined by \n */
+	tsv,
+	/** one JSON object per command: {"line":1,"command":"...","output":["...", ...]} */
+	jsonl
+};
+
+/** the words of a command line, views into the line allocated from the command's scratch arena */
+using CommandTokens = std::pmr::vector<std::string_view>;
+
+class AdvisorMain {
+
+	public:
+		AdvisorMain();
+		/** construct, loading the dataset with the sent options */
+		AdvisorMain(OrderBookOptions options);
+		/** construct a session over the days of a catalog, which can be shared by many sessions. The session only reads them.
+			The commands are counted in stats when it is sent, so many sessions can share one, and in stats of the session's own otherwise */
+		AdvisorMain(DatasetCatalog& _catalog, CommandStats* _stats = nullptr);
+		/** Call this to start the sim*/
+		void init();
+		/** runs the commands of the sent stream, one per line until it ends, and writes their answers to output in the sent format.
+			Returns the number of commands run */
+		size_t runBatch(std::istream& commands, std::ostream& output, BatchFormat format);
+		/** runs one command and writes its answer to output in the sent format, lineNumber is only used by the tsv and jsonl records */
+		void runCommand(const std::string& command, size_t lineNumber, std::ostream& output, BatchFormat format);
+		/** splits the sent line at spaces. The tokens are views into userOption and the vector is allocated from resource */
+		static CommandTokens userOptionTokenise(std::string_view userOption, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		/** what the stats command prints: the latency and work of the commands run so far and how the current day was loaded */
+		void printStats(std::ostream& output);
+		
+	private:
+		/** a command: the first word of its line, what it is counted as and the method that answers it */
+		struct CommandHandler {
+			std::string_view name;
+			CommandStats::Command command;
+			void (AdvisorMain::*run)(const CommandTokens& userOptionLine);
+		};
+		static const CommandHandler commandTable[];
+		/** the handler whose name is the sent word, nullptr if it is not a command */
+		static const CommandHandler* findCommand(std::string_view name);
+		/** converts a whole token to an int without allocating, false if it is not a number or has other characters after it */
+		static bool parseNumber(std::string_view text, int& number);
+		static bool parseNumber(std::string_view text, double& number);
+		/** reads a time from the tokens at position: "hh:mm:ss[.f]" on the day of base, or a date and a time as two tokens.
+			Moves position past the tokens it read, returns false if they are not a time */
+		static bool parseTime(const CommandTokens& tokens, size_t& position, int64_t base, int64_t& time);
+		/** reads 'from <time> to <time>' from the tokens at position up to the end of the line, times of day are on the current day */
+		bool parseTimeRange(const CommandTokens& tokens, size_t position, int64_t& from, int64_t& to) const;
+
+		void printMenu();
+		void printHelp(const CommandTokens& userOptionLine);
+		void printProducts(const CommandTokens& userOptionLine);
+		void printMinMax(const CommandTokens& userOptionLine);
+		void printAvg(const CommandTokens& userOptionLine);
+		void printPredict(const CommandTokens& userOptionLine);
+		void printTime(const CommandTokens& userOptionLine);
+		void printCommandStats(const CommandTokens& userOptionLine);
+		void gotoNextTimeFrame(const CommandTokens& userOptionLine);
+		void placeOrder(const CommandTokens& userOptionLine);
+		void printOrders(const CommandTokens& userOptionLine);
+		void cancelOrder(const CommandTokens& userOptionLine);
+		void printSales(const CommandTokens& userOptionLine);
+		void printDepth(const CommandTokens& userOptionLine);
+		void printFill(const CommandTokens& userOptionLine);
+		void printImbalance(const CommandTokens& userOptionLine);
+		void gotoTime(const CommandTokens& userOptionLine);
+		void printSummary(const CommandTokens& userOptionLine);
+		/** answers 'min/max/avg product ask/bid from <time> to <time>' over the timesteps of the time range */
+		void printTimeRangeStats(const CommandTokens& userOptionLine);
+		/** sets the precision the prices of product are printed with */
+		void usePrecisionOf(std::string_view product);
+		/** matches the current timestep unless the matching engine holds it already */
+		void matchCurrentTimestep();
+		/** prints the sales of the user's orders from the sent position of the matching engine's sales on */
+		void printUserSales(size_t firstSale);
+		/** reads the next line the user types, returns false when the input has ended */
+		bool getUserOption(std::string& userOption);
+		/** runs one command through the command table, timing it and counting its work in the command stats */
+		void processUserOption(const std::string& userOption);
+		void printLiquidity(const CommandTokens& userOptionLine);
+		static void writeRecord(std::ostream& output, BatchFormat format, size_t lineNumber, const std::string& command, const std::vector<std::string>& answerLines);
+		static void writeEscaped(std::ostream& output, const std::string& text, bool json);
+		static void stripCarriageReturn(std::string& line);
+		/** moves the cursor to the first timestep of the sent day */
+		void moveToDay(size_t day);
+		/** moves the cursor steps timesteps on, crossing into the next days and wrapping around at the end of the timeline */
+		void moveForward(size_t steps);
+		/** number of timesteps in the segments of a window */
+		static size_t windowLength(const std::pmr::vector<DaySegment>& window);
+		/** locks the followed day for the length of a command, if there is one */
+		std::shared_lock<std::shared_mutex> readLock();
+		/** where the commands write their answers, std::cout unless runCommand redirected it */
+		std::ostream* out = &std::cout;
+		/** collects the answer of a command written as a tsv or jsonl record */
+		std::ostringstream answer;
+		std::vector<std::string> answerLines;
+
+		/** set when this session made the catalog itself */
+		std::unique_ptr<DatasetCatalog> ownedCatalog;
+		DatasetCatalog& catalog;
+		/** the day a CSVTail appends to, nullptr when not following */
+		std::shared_ptr<OrderBook> liveDay;
+		/** the cursor: timestep currentStep of day currentDay, whose orderbook is book */
+		size_t currentDay = 0;
+		size_t currentStep = 0;
+		std::shared_ptr<const OrderBook> book;
+		std::unique_ptr<CommandStats> ownedStats;
+		/** where the commands of this session are counted */
+		CommandStats* commandStats;
+		/** the temporaries of a command (tokens, windows, price series) are allocated here and released together after the command.
+			Commands whose temporaries fit the buffer do not allocate at all */
+		alignas(std::max_align_t) unsigned char scratchBuffer[4096];
+		std::pmr::monotonic_buffer_resource scratch{scratchBuffer, sizeof(scratchBuffer)};
+		/** moving averages for predict over the current day, cached across commands */
+		std::unique_ptr<IndicatorEngine> indicators;
+		/** the orders the user submitted, matched against the dataset at each timestep the cursor goes through */
+		MatchingEngine matching;
+		/** the name the orders of this session are submitted under */
+		static const char* const username;
+
+};
+
@@ -0,0 +1,277 @@
+#include "AdvisorServer.h"
+#include <iostream>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+namespace {
+	/** write end of the wake pipe of the running server, for the signal handler */
+	volatile int signalWakeFd = -1;
+	volatile std::sig_atomic_t signalled = 0;
+
+	extern "C" void handleStopSignal(int) {
+		signalled = 1;
+		if (signalWakeFd >= 0) {
+			ssize_t written = write(signalWakeFd, "s", 1);
+			(void)written;
+		}
+	}
+
+	/** writes all of the sent bytes, returns false if the client stopped reading or hung up */
+	bool sendAll(int socket, const char* data, size_t size) {
+		while (size > 0) {
+			ssize_t sent = send(socket, data, size, 0);
+			if (sent < 0 && errno == EINTR) continue;
+			if (sent <= 0) return false;
+			data += sent;
+			size -= sent;
+		}
+		return true;
+	}
+}
+#endif
+
+AdvisorServer::AdvisorServer(DatasetCatalog& _catalog, ServerOptions _options, CommandStats& _stats)
+	: catalog(_catalog), options(_options), stats(_stats), listenSocket(-1), stopping(false) {
+	wakePipe[0] = -1;
+	wakePipe[1] = -1;
+	if (options.workers == 0) {
+		options.workers = std::thread::hardware_concurrency() == 0 ? 1 : std::thread::hardware_concurrency();
+	}
+}
+
+AdvisorServer::~AdvisorServer() {
+	closeSockets();
+}
+
+#ifdef _WIN32
+
+bool AdvisorServer::run() {
+	std::cerr << "The server needs Unix domain sockets, it is not available in this build" << std::endl;
+	return false;
+}
+
+void AdvisorServer::stop() {
+	stopping = true;
+}
+
+void AdvisorServer::work() {}
+void AdvisorServer::serve(Connection& connection) {}
+void AdvisorServer::release(Connection* connection) {}
+void AdvisorServer::wake() {}
+void AdvisorServer::closeSockets() {}
+
+#else
+
+bool AdvisorServer::run() {
+	if (options.format == BatchFormat::text) {
+		std::cerr << "The server answers in tsv or jsonl, one line per command" << std::endl;
+		return false;
+	}
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (options.socketPath.empty() || options.socketPath.size() >= sizeof(address.sun_path)) {
+		std::cerr << "Socket path must be 1 to " << sizeof(address.sun_path) - 1 << " characters" << std::endl;
+		return false;
+	}
+	std::memcpy(address.sun_path, options.socketPath.c_str(), options.socketPath.size() + 1);
+
+	listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenSocket < 0 || pipe(wakePipe) != 0) {
+		std::cerr << "Could not create the server socket: " << std::strerror(errno) << std::endl;
+		closeSockets();
+		return false;
+	}
+	// a full pipe already holds a wake up, so writes to it must not block
+	fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+	unlink(options.socketPath.c_str()); // a socket left by an earlier run
+	if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenSocket, SOMAXCONN) != 0) {
+		std::cerr << "Could not listen on " << options.socketPath << ": " << std::strerror(errno) << std::endl;
+		closeSockets();
+		return false;
+	}
+
+	signal(SIGPIPE, SIG_IGN); // a client hanging up mid answer fails the send instead of killing the server
+	signalled = 0;
+	signalWakeFd = wakePipe[1];
+	signal(SIGINT, handleStopSignal);
+	signal(SIGTERM, handleStopSignal);
+
+	for (unsigned int i = 0; i < options.workers; i++) {
+		workers.emplace_back(&AdvisorServer::work, this);
+	}
+	std::cerr << "Serving on " << options.socketPath << " with " << options.workers << " workers" << std::endl;
+
+	// connections waiting for input, owned here. Connections handed to a worker stay in the map but are not polled
+	std::unordered_map<int, std::unique_ptr<Connection>> connections;
+	std::vector<int> idle;
+	std::vector<pollfd> polled;
+	while (!stopping && !signalled) {
+		polled.clear();
+		polled.push_back(pollfd{wakePipe[0], POLLIN, 0});
+		polled.push_back(pollfd{listenSocket, POLLIN, 0});
+		for (int socket : idle) {
+			polled.push_back(pollfd{socket, POLLIN, 0});
+		}
+		if (poll(polled.data(), polled.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+			break;
+		}
+
+		if (polled[0].revents != 0) { // workers released connections, or stop was asked for
+			char drain[256];
+			while (read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+			std::vector<Connection*> done;
+			{
+				std::lock_guard<std::mutex> lock{releasedMutex};
+				done.swap(released);
+			}
+			for (Connection* connection : done) {
+				if (connection->closed) {
+					close(connection->socket);
+					connections.erase(connection->socket);
+				} else {
+					idle.push_back(connection->socket);
+				}
+			}
+		}
+
+		if (polled[1].revents & POLLIN) {
+			int client = accept(listenSocket, nullptr, nullptr);
+			if (client >= 0) {
+				timeval timeout{5, 0}; // a client that stops reading its answers cannot hold a worker for longer than this
+				setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+				connections[client] = std::unique_ptr<Connection>{new Connection{client}};
+				idle.push_back(client);
+			}
+		}
+
+		std::vector<int> stillIdle;
+		for (size_t i = 2; i < polled.size(); i++) {
+			if (polled[i].revents == 0) {
+				stillIdle.push_back(polled[i].fd);
+				continue;
+			}
+			std::lock_guard<std::mutex> lock{readyMutex};
+			ready.push_back(connections[polled[i].fd].get());
+			readyCondition.notify_one();
+		}
+		// sockets accepted or released above were not in this poll, keep them
+		for (size_t i = polled.size() - 2; i < idle.size(); i++) {
+			stillIdle.push_back(idle[i]);
+		}
+		idle.swap(stillIdle);
+	}
+
+	stop();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	for (auto& entry : connections) {
+		close(entry.first);
+	}
+	signalWakeFd = -1;
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	closeSockets();
+	unlink(options.socketPath.c_str());
+	return true;
+}
+
+void AdvisorServer::stop() {
+	{
+		std::lock_guard<std::mutex> lock{readyMutex};
+		stopping = true;
+	}
+	readyCondition.notify_all();
+	wake();
+}
+
+void AdvisorServer::work() {
+	while (true) {
+		Connection* connection;
+		{
+			std::unique_lock<std::mutex> lock{readyMutex};
+			readyCondition.wait(lock, [this] { return stopping || !ready.empty(); });
+			if (stopping) return;
+			connection = ready.front();
+			ready.pop_front();
+		}
+		serve(*connection);
+		release(connection);
+	}
+}
+
+void AdvisorServer::serve(Connection& connection) {
+	char buffer[16 * 1024];
+	ssize_t received = recv(connection.socket, buffer, sizeof(buffer), 0);
+	if (received <= 0) { // end of input, or an error
+		connection.closed = received == 0 || errno != EINTR;
+		return;
+	}
+	connection.input.append(buffer, received);
+	if (!connection.session) {
+		connection.session.reset(new AdvisorMain{catalog, &stats});
+	}
+
+	// answers of every complete line go out in one send
+	connection.output.str("");
+	size_t start = 0;
+	size_t end;
+	while ((end = connection.input.find('\n', start)) != std::string::npos) {
+		size_t length = end - start;
+		if (length > 0 && connection.input[end - 1] == '\r') length--;
+		connection.lineNumber++;
+		connection.session->runCommand(connection.input.substr(start, length), connection.lineNumber, connection.output, options.format);
+		start = end + 1;
+	}
+	connection.input.erase(0, start);
+	if (connection.input.size() > maxLineLength) {
+		connection.closed = true;
+		return;
+	}
+
+	const std::string& answers = connection.output.str();
+	if (!answers.empty() && !sendAll(connection.socket, answers.data(), answers.size())) {
+		connection.closed = true;
+	}
+}
+
+void AdvisorServer::release(Connection* connection) {
+	{
+		std::lock_guard<std::mutex> lock{releasedMutex};
+		released.push_back(connection);
+	}
+	wake();
+}
+
+void AdvisorServer::wake() {
+	if (wakePipe[1] >= 0) {
+		ssize_t written = write(wakePipe[1], "w", 1);
+		(void)written;
+	}
+}
+
+void AdvisorServer::closeSockets() {
+	if (listenSocket >= 0) close(listenSocket);
+	if (wakePipe[0] >= 0) close(wakePipe[0]);
+	if (wakePipe[1] >= 0) close(wakePipe[1]);
+	listenSocket = -1;
+	wakePipe[0] = -1;
+	wakePipe[1] = -1;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+#include "AdvisorMain.h"
+#include "DatasetCatalog.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Settings of the query server */
+struct ServerOptions {
+	/** path of the Unix domain socket, an existing file there is replaced */
+	std::string socketPath;
+	/** threads running the commands, 0 uses one per hardware thread */
+	unsigned int workers = 0;
+	/** format of the answers, one line per command. text is not allowed, its answers can span several lines */
+	BatchFormat format = BatchFormat::jsonl;
+};
+
+/** Serves the commands of AdvisorMain to many clients at once over a Unix domain socket.
+	A client sends one command per line and gets one tsv or jsonl record per command back, in order.
+	Every connection has its own AdvisorMain session, so its own timestep cursor, over one shared catalog of orderbooks that are only read.
+	One thread waits on the sockets and hands connections with input to a fixed pool of workers, a connection is only on one worker at a time */
+class AdvisorServer {
+	public:
+		/** the commands of every client are counted in stats */
+		AdvisorServer(DatasetCatalog& _catalog, ServerOptions _options, CommandStats& _stats);
+		~AdvisorServer();
+		AdvisorServer(const AdvisorServer&) = delete;
+		AdvisorServer& operator=(const AdvisorServer&) = delete;
+
+		/** listens and serves clients until stop() is called or the process gets SIGINT or SIGTERM.
+			Returns false if the socket could not be set up */
+		bool run();
+		/** makes run() return, can be called from any thread */
+		void stop();
+
+	private:
+		struct Connection {
+			Connection(int _socket) : socket(_socket) {}
+			int socket;
+			/** received bytes after the last complete line */
+			std::string input;
+			std::ostringstream output;
+			/** made by the first worker the connection is handed to, as making it can load a day */
+			std::unique_ptr<AdvisorMain> session;
+			size_t lineNumber = 0;
+			/** set by the worker when the client hung up or misbehaved */
+			bool closed = false;
+		};
+
+		/** worker loop: runs the complete lines received on each connection it is handed */
+		void work();
+		/** reads what the client sent and answers every complete line. Marks the connection closed on end of input or error */
+		void serve(Connection& connection);
+		/** hands a connection back to the thread waiting on the sockets */
+		void release(Connection* connection);
+		void wake();
+		void closeSockets();
+
+		/** longest command accepted, a client sending a longer line is disconnected */
+		static const size_t maxLineLength = 64 * 1024;
+
+		DatasetCatalog& catalog;
+		ServerOptions options;
+		CommandStats& stats;
+		int listenSocket;
+		/** written to wake the thread waiting on the sockets, read end first */
+		int wakePipe[2];
+		std::atomic<bool> stopping;
+
+		std::vector<std::thread> workers;
+		/** connections with input, waiting for a worker */
+		std::deque<Connection*> ready;
+		std::mutex readyMutex;
+		std::condition_variable readyCondition;
+		/** connections the workers are done with, waiting to be polled again or closed */
+		std::vector<Connection*> released;
+		std::mutex releasedMutex;
+};
@@ -0,0 +1,124 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+	std::atomic<bool> counting{false};
+	std::atomic<uint64_t> allocations{0};
+	std::atomic<uint64_t> allocatedBytes{0};
+}
+
+void AllocationCounter::setCounting(bool _counting) {
+	counting.store(_counting, std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::getAllocations() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::getBytes() {
+	return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+namespace {
+	void count(std::size_t size) {
+		if (counting.load(std::memory_order_relaxed)) {
+			allocations.fetch_add(1, std::memory_order_relaxed);
+			allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		}
+	}
+
+	/** malloc, or the aligned allocation of the platform when alignment is above what malloc guarantees. Null when out of memory */
+	void* allocate(std::size_t size, std::size_t alignment) {
+		if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+#else
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment); // the size has to be a multiple of the alignment
+#endif
+	}
+
+	void release(void* memory, std::size_t alignment) noexcept {
+#ifdef _WIN32
+		if (alignment > alignof(std::max_align_t)) {
+			_aligned_free(memory);
+			return;
+		}
+#else
+		(void)alignment;
+#endif
+		std::free(memory);
+	}
+
+	/** the throwing new: counts, then calls the new handler until the allocation succeeds or there is no handler */
+	void* newMemory(std::size_t size, std::size_t alignment) {
+		count(size);
+		if (size == 0) size = 1;
+		while (true) {
+			void* memory = allocate(size, alignment);
+			if (memory != nullptr) {
+				return memory;
+			}
+			std::new_handler handler = std::get_new_handler();
+			if (handler == nullptr) {
+				throw std::bad_alloc{};
+			}
+			handler();
+		}
+	}
+
+	void* newMemoryNothrow(std::size_t size, std::size_t alignment) noexcept {
+		try {
+			return newMemory(size, alignment);
+		} catch (...) {
+			return nullptr;
+		}
+	}
+}
+
+// every form of new and delete is replaced, so none of them falls through to a library allocator the others do not match.
+// The array forms call these ones
+void* operator new(std::size_t size) {
+	return newMemory(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return newMemoryNothrow(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	return newMemory(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return newMemoryNothrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+	release(memory, alignof(std::max_align_t));
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	release(memory, alignof(std::max_align_t));
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	release(memory, alignof(std::max_align_t));
+}
+
+void operator delete(void* memory, std::align_val_t alignment) noexcept {
+	release(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept {
+	release(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	release(memory, static_cast<std::size_t>(alignment));
+}
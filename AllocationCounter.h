@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/** Counts the calls to the global operator new of the whole program while counting is on.
+	Off by default, where an allocation only pays for checking a flag */
+class AllocationCounter {
+	public:
+		/** turns counting on or off for every thread */
+		static void setCounting(bool counting);
+		/** allocations and bytes counted so far, take the difference of two reads to count what happened between them */
+		static uint64_t getAllocations();
+		static uint64_t getBytes();
+};
@@ -0,0 +1,215 @@
+#include "Benchmark.h"
+#include "AdvisorMain.h"
+#include "AllocationCounter.h"
+#include "CSVReader.h"
+#include "DatasetCatalog.h"
+#include "MatchingEngine.h"
+#include "PriceKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <streambuf>
+
+namespace {
+	/** the bits of every field are equal, so -0 and 0 differ. Any two nan are the same, which nan an add returns depends on
+		the order of its operands and compilers swap them */
+	bool sameBits(const PriceSummary& a, const PriceSummary& b) {
+		const double PriceSummary::* fields[] = {&PriceSummary::min, &PriceSummary::max, &PriceSummary::priceSum, &PriceSummary::amountSum, &PriceSummary::notional};
+		for (const double PriceSummary::* field : fields) {
+			bool bothNan = std::isnan(a.*field) && std::isnan(b.*field);
+			if (!bothNan && std::memcmp(&(a.*field), &(b.*field), sizeof(double)) != 0) return false;
+		}
+		return a.count == b.count;
+	}
+
+	/** accepts and drops everything written to it, so the answers of the commands are formatted but not kept */
+	class DiscardBuffer : public std::streambuf {
+		protected:
+			int overflow(int c) override { return traits_type::not_eof(c); }
+			std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+	};
+}
+
+template <typename Operation>
+BenchmarkResult Benchmark::measure(const std::string& name, double minSeconds, Operation operation) {
+	BenchmarkResult result;
+	result.name = name;
+	uint64_t allocations = AllocationCounter::getAllocations();
+	auto start = std::chrono::steady_clock::now();
+	do {
+		operation();
+		result.iterations++;
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (result.seconds < minSeconds);
+	result.allocations = AllocationCounter::getAllocations() - allocations;
+	result.nsPerOp = result.seconds * 1e9 / static_cast<double>(result.iterations);
+	return result;
+}
+
+bool Benchmark::kernelsIdentical(const OrderBook& book) {
+	struct Column {
+		const double* prices;
+		const double* amounts;
+		size_t count;
+	};
+	std::vector<Column> columns;
+	std::vector<OrderRange> ranges; // keep the rows in memory when the book is out of core
+	for (size_t t = 0; t < book.getTimestepCount(); t++) {
+		for (size_t p = 0; p < book.getKnownProducts().size(); p++) {
+			for (OrderBookType type : {OrderBookType::bid, OrderBookType::ask}) {
+				ranges.push_back(book.getOrderRange(type, p, t));
+				columns.push_back(Column{ranges.back().prices(), ranges.back().amounts(), ranges.back().size()});
+			}
+		}
+	}
+	const double infinity = std::numeric_limits<double>::infinity();
+	const double edgeValues[] = {1.5, -0.0, 0.0, infinity, 0.1, -infinity, std::numeric_limits<double>::quiet_NaN(), 4.9e-324, -7.25, 3.25e300, 0.0245};
+	std::vector<double> edge;
+	for (size_t i = 0; i < 40; i++) edge.push_back(edgeValues[(i * 7) % (sizeof(edgeValues) / sizeof(edgeValues[0]))]);
+	std::vector<double> edgeAmounts(edge.rbegin(), edge.rend());
+	for (size_t count = 0; count <= edge.size(); count++) { // every tail length, with and without amounts
+		columns.push_back(Column{edge.data(), edgeAmounts.data(), count});
+		columns.push_back(Column{edge.data() + edge.size() - count, nullptr, count});
+	}
+
+	PriceKernel original = PriceKernels::active();
+	PriceKernels::select(PriceKernel::scalar);
+	std::vector<PriceSummary> expected;
+	for (const Column& column : columns) expected.push_back(PriceKernels::summarise(column.prices, column.amounts, column.count));
+	bool identical = true;
+	for (PriceKernel kernel : {PriceKernel::sse2, PriceKernel::avx2, PriceKernel::avx512}) {
+		if (!PriceKernels::select(kernel)) continue;
+		for (size_t c = 0; c < columns.size(); c++) {
+			PriceSummary summary = PriceKernels::summarise(columns[c].prices, columns[c].amounts, columns[c].count);
+			identical = identical && sameBits(summary, expected[c]);
+		}
+	}
+	PriceKernels::select(original);
+	return identical;
+}
+
+void Benchmark::writeResult(std::ostream& output, const BenchmarkResult& result) {
+	output << "{\"name\":\"" << result.name << "\",\"iterations\":" << result.iterations
+		   << ",\"seconds\":" << result.seconds << ",\"nsPerOp\":" << result.nsPerOp
+		   << ",\"allocationsPerOp\":" << static_cast<double>(result.allocations) / static_cast<double>(result.iterations);
+	if (result.bytes > 0) {
+		output << ",\"mbPerSecond\":" << static_cast<double>(result.bytes) / (result.nsPerOp / 1e9) / (1024 * 1024);
+	}
+	if (result.orders > 0) {
+		output << ",\"ordersPerSecond\":" << static_cast<double>(result.orders) / (result.nsPerOp / 1e9);
+	}
+	output << "}";
+}
+
+bool Benchmark::run(const BenchmarkOptions& options, std::ostream& output) {
+	OrderBookOptions load = options.load;
+	load.useSnapshot = false;
+	load.follow = false;
+	AllocationCounter::setCounting(true);
+	std::vector<std::string> names = DataGenerator::productNames(std::max<size_t>(options.generator.products, 1));
+	std::string product = names.size() > 3 ? names[3] : names[0]; // ETH/BTC when the exchange products are there
+
+	output << "{\"generator\":{\"products\":" << names.size() << ",\"ordersPerTimestep\":" << options.generator.ordersPerTimestep
+		   << ",\"seed\":" << options.generator.seed << "},\"kernel\":\"" << PriceKernels::name(PriceKernels::active())
+		   << "\",\"minSeconds\":" << options.minSeconds << ",\"datasets\":[";
+	for (size_t s = 0; s < options.sizes.size(); s++) {
+		DataGeneratorOptions generator = options.generator;
+		generator.timesteps = options.sizes[s];
+		generator.fileSize = 0;
+		std::string filename = (std::filesystem::path{options.directory} / ("bench_" + std::to_string(generator.timesteps) + ".csv")).string();
+		DataGeneratorResult dataset;
+		if (!DataGenerator::writeFile(generator, filename, dataset)) {
+			AllocationCounter::setCounting(false);
+			return false;
+		}
+
+		std::vector<BenchmarkResult> results;
+		results.push_back(measure("readCSV", options.minSeconds, [&] {
+			CSVReader::readCSV(filename);
+		}));
+		results.back().bytes = dataset.bytes;
+		results.push_back(measure("ingest", options.minSeconds, [&] {
+			OrderBook book{filename, load};
+		}));
+		results.back().bytes = dataset.bytes;
+		// out of core, the book is loaded from its compressed block file, which reads the index and leaves the blocks on disk
+		OrderBookOptions blockLoad = load;
+		blockLoad.outOfCore = true;
+		blockLoad.useSnapshot = true; // a block file is only read back when snapshots are used
+		blockLoad.pageBudget = 0;
+		{
+			OrderBook writer{filename, blockLoad};
+		}
+		BlockCacheCounters decoded; // every block decoded once, for the compression ratio and the decode speed
+		BlockFile blockFile{0};
+		if (blockFile.open(BlockFile::blockFilename(filename)) == SnapshotStatus::ok) {
+			for (size_t b = 0; b < blockFile.getBlockCount(); b++) blockFile.getBlock(b);
+			decoded = blockFile.getCounters();
+		}
+		results.push_back(measure("blockLoad", options.minSeconds, [&] {
+			OrderBook book{filename, blockLoad};
+		}));
+		results.back().bytes = dataset.bytes;
+
+		DatasetCatalog catalog{std::vector<std::string>{filename}, load};
+		std::shared_ptr<const OrderBook> book = catalog.getDay(0);
+		size_t timesteps = book->getTimestepCount();
+		size_t timestep = 0;
+		results.push_back(measure("getOrders", options.minSeconds, [&] {
+			book->getOrders(OrderBookType::ask, product, timestep);
+			timestep = timestep + 1 < timesteps ? timestep + 1 : 0;
+		}));
+		MatchingEngine engine;
+		results.push_back(measure("match", options.minSeconds, [&] { // every timestep of the day through the matching engine
+			for (size_t t = 0; t < timesteps; t++) {
+				engine.matchTimestep(*book, t);
+			}
+		}));
+		results.back().orders = dataset.rows;
+
+		// the commands run from the middle of the dataset, where avg and predict have the timesteps they look back on
+		DiscardBuffer discard;
+		std::ostream answers{&discard};
+		AdvisorMain session{catalog};
+		session.runCommand("step " + std::to_string(timesteps / 2), 0, answers, BatchFormat::text);
+		const std::pair<const char*, std::string> commands[] = {
+			{"prod", "prod"},
+			{"min", "min " + product + " ask"},
+			{"max", "max " + product + " bid"},
+			{"avg", "avg " + product + " ask 10"},
+			{"predict", "predict max " + product + " bid"},
+			{"liquidity", "liquidity " + product},
+			{"depth", "depth " + product + " 1"},
+			{"fill", "fill " + product + " bid 50"},
+			{"range", "min " + product + " ask from " + book->getTimestamp(timesteps / 4) + " to " + book->getTimestamp(timesteps * 3 / 4)},
+			{"summary", "summary 10"},
+			{"time", "time"},
+			{"step", "step"}
+		};
+		for (const auto& command : commands) {
+			results.push_back(measure(command.first, options.minSeconds, [&] {
+				session.runCommand(command.second, 0, answers, BatchFormat::text);
+			}));
+		}
+
+		output << (s == 0 ? "\n" : ",\n") << "{\"timesteps\":" << dataset.timesteps << ",\"rows\":" << dataset.rows
+			   << ",\"bytes\":" << dataset.bytes << ",\"kernelsIdentical\":" << (kernelsIdentical(*book) ? "true" : "false");
+		if (decoded.encodedBytes > 0) {
+			output << ",\"compressionRatio\":" << static_cast<double>(decoded.decodedBytes) / static_cast<double>(decoded.encodedBytes)
+				   << ",\"decodeMbPerSecond\":" << decoded.decodedBytes / (1024.0 * 1024.0) / std::max(decoded.decodeSeconds, 1e-9);
+		}
+		output << ",\"results\":[";
+		for (size_t r = 0; r < results.size(); r++) {
+			output << (r == 0 ? "\n  " : ",\n  ");
+			writeResult(output, results[r]);
+		}
+		output << "\n]}";
+		output.flush();
+	}
+	output << "\n]}\n";
+	AllocationCounter::setCounting(false);
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "DataGenerator.h"
+#include "OrderBook.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** Settings of a benchmark run */
+struct BenchmarkOptions {
+	/** directory the generated datasets are written to */
+	std::string directory = ".";
+	/** timesteps of each generated dataset, one set of results per size */
+	std::vector<size_t> sizes{100, 1000, 10000};
+	/** products, orders per timestep and seed of the generated datasets, see DataGeneratorOptions */
+	DataGeneratorOptions generator;
+	/** how the datasets are loaded, snapshots are never used so ingest always parses the csv */
+	OrderBookOptions load;
+	/** each case is repeated until it has run this long, and at least once */
+	double minSeconds = 0.25;
+};
+
+/** Timing of one benchmark case */
+struct BenchmarkResult {
+	std::string name;
+	size_t iterations = 0;
+	/** heap allocations of all iterations, see AllocationCounter */
+	uint64_t allocations = 0;
+	/** bytes an iteration reads, 0 if it is not a throughput case */
+	size_t bytes = 0;
+	/** orders an iteration matches, 0 if it is not a matching case */
+	size_t orders = 0;
+	double seconds = 0;
+	/** seconds / iterations, in nanoseconds */
+	double nsPerOp = 0;
+};
+
+/** Generates datasets of several sizes and times loading them and running the AdvisorMain commands on them.
+	The results are written as one JSON document, so the output of two runs can be compared */
+class Benchmark {
+	public:
+		/** runs every case on every size and writes the JSON report to output, returns false if a dataset could not be written */
+		static bool run(const BenchmarkOptions& options, std::ostream& output);
+
+	private:
+		/** calls operation until minSeconds have passed */
+		template <typename Operation>
+		static BenchmarkResult measure(const std::string& name, double minSeconds, Operation operation);
+		static void writeResult(std::ostream& output, const BenchmarkResult& result);
+		/** runs PriceKernels::summarise with every version the cpu supports on each group of rows of the book, and on columns of every
+			length up to a few blocks of lanes holding signed zeros, infinities and nan. Returns false if any result differs in a bit
+			from the scalar one */
+		static bool kernelsIdentical(const OrderBook& book);
+};
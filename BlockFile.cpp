@@ -0,0 +1,484 @@
+#include "BlockFile.h"
+#include "ColumnCodec.h"
+#include "OrderBook.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+// File layout, all integers in host byte order:
+//   header     see BlockFileHeader
+//   products   productCount times (uint32 length, bytes)
+//   timestepCount timestamps, groupCount group offsets and groupCount depth offsets, each as ColumnCodec deltas
+//   min, max, price sum, amount sum and notional of the groups with rows, each as a ColumnCodec column. Their counts are the
+//   group sizes
+//   blockCount BlockInfo entries
+//   then each block at an offset that is a multiple of MappedFile::granularity, holding for each of its groups: the varint row
+//   and level counts, the price and amount columns of the rows as ColumnCodec columns when there are rows, and the ladder order
+//   of the rows as ColumnCodec indexes when there are levels
+// The checksum covers the dictionaries, the offsets, the group statistics and the block index, not the blocks.
+
+namespace {
+	const char blockMagic[8] = {'A', 'D', 'V', 'B', 'L', 'O', 'C', 'K'};
+	const uint32_t byteOrderMark = 0x01020304;
+
+	struct BlockFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t rowCount;
+		uint64_t timestepCount;
+		uint64_t productCount;
+		uint64_t groupCount;
+		uint64_t levelCount;
+		uint64_t blockCount;
+		uint64_t indexSize;
+		uint64_t fileSize;
+		uint64_t checksum;
+	};
+
+	void appendBytes(std::vector<char>& out, const void* data, size_t size) {
+		const char* bytes = static_cast<const char*>(data);
+		out.insert(out.end(), bytes, bytes + size);
+	}
+
+	template <typename T>
+	bool readColumn(const char*& p, const char* end, uint64_t count, std::vector<T>& column) {
+		if (static_cast<uint64_t>(end - p) / sizeof(T) < count) return false;
+		column.resize(count);
+		std::memcpy(column.data(), p, count * sizeof(T));
+		p += count * sizeof(T);
+		return true;
+	}
+
+	/** the statistics of a group that are not its row count */
+	double OrderStats::* const statFields[] = {&OrderStats::min, &OrderStats::max, &OrderStats::priceSum, &OrderStats::amountSum, &OrderStats::notional};
+
+	uint64_t alignUp(uint64_t offset) {
+		return (offset + MappedFile::granularity - 1) / MappedFile::granularity * MappedFile::granularity;
+	}
+
+	/** writes zeros until the stream is at offset */
+	void padTo(std::ofstream& out, uint64_t position, uint64_t offset) {
+		static const char zeros[4096] = {};
+		while (position < offset) {
+			size_t chunk = static_cast<size_t>(std::min<uint64_t>(sizeof(zeros), offset - position));
+			out.write(zeros, chunk);
+			position += chunk;
+		}
+	}
+}
+
+BlockFile::BlockFile(size_t _pageBudget) : endOffset(0), pageBudget(_pageBudget), lastBlock(SIZE_MAX), readaheadBlock(SIZE_MAX), failureReported(false) {
+
+}
+
+bool BlockFile::write(const std::string& filename,
+					  const OrderStore& store,
+					  const std::vector<size_t>& groupOffsets,
+					  const std::vector<size_t>& depthOffsets,
+					  const std::vector<uint32_t>& ladderOrders,
+					  const std::vector<OrderStats>& groupStats) {
+	size_t timesteps = store.timestamps.size();
+	size_t groupsPerStep = timesteps == 0 ? 0 : (groupOffsets.size() - 1) / timesteps;
+	auto rowOf = [&](size_t timestep) { return groupOffsets[timestep * groupsPerStep]; };
+	auto levelOf = [&](size_t timestep) { return depthOffsets[timestep * groupsPerStep]; };
+
+	// whole timesteps are added to a block until its decoded columns and levels reach the target size
+	std::vector<BlockInfo> index;
+	for (size_t t = 0; t < timesteps;) {
+		BlockInfo info{};
+		info.firstTimestep = t;
+		info.firstRow = rowOf(t);
+		info.firstLevel = levelOf(t);
+		do {
+			t++;
+		} while (t < timesteps && (rowOf(t) - info.firstRow) * 2 * sizeof(double) + (levelOf(t) - info.firstLevel) * sizeof(DepthLevel) < targetBlockBytes);
+		info.rowCount = rowOf(t) - info.firstRow;
+		info.levelCount = levelOf(t) - info.firstLevel;
+		info.groupCount = (t - info.firstTimestep) * groupsPerStep;
+		index.push_back(info);
+	}
+
+	std::vector<char> metadata;
+	for (const std::string& product : store.products) {
+		uint32_t length = static_cast<uint32_t>(product.size());
+		appendBytes(metadata, &length, sizeof(length));
+		appendBytes(metadata, product.data(), product.size());
+	}
+	ColumnCodec::encodeDeltas(store.timestamps, metadata);
+	ColumnCodec::encodeDeltas(groupOffsets, metadata);
+	ColumnCodec::encodeDeltas(depthOffsets, metadata);
+	std::vector<double> column;
+	for (double OrderStats::* field : statFields) {
+		column.clear();
+		for (size_t g = 0; g + 1 < groupOffsets.size(); g++) {
+			if (groupOffsets[g + 1] > groupOffsets[g]) column.push_back(groupStats[g].*field);
+		}
+		ColumnCodec::encode(column.data(), column.size(), 1, metadata);
+	}
+	uint64_t offset = alignUp(sizeof(BlockFileHeader) + metadata.size() + index.size() * sizeof(BlockInfo));
+
+	// written under a temporary name and renamed, so a half written file is never picked up. The blocks are encoded and
+	// written one at a time, then the header and the index go in front of them once the block sizes are known
+	std::string tempFilename = filename + ".tmp";
+	{
+		std::ofstream out{tempFilename, std::ios::binary | std::ios::trunc};
+		if (!out.is_open()) {
+			return false;
+		}
+		padTo(out, 0, offset);
+		std::vector<char> encoded;
+		uint64_t end = offset;
+		size_t ladderPosition = 0;
+		for (BlockInfo& info : index) { // the blocks start on mapping boundaries, so each can be mapped on its own
+			// each group is a column of its own, so every product gets the decimal scale of its own prices and amounts
+			encoded.clear();
+			size_t firstGroup = static_cast<size_t>(info.firstTimestep) * groupsPerStep;
+			for (size_t g = firstGroup; g < firstGroup + info.groupCount; g++) {
+				size_t rows = groupOffsets[g + 1] - groupOffsets[g];
+				size_t levels = depthOffsets[g + 1] - depthOffsets[g];
+				ColumnCodec::appendVarint(encoded, rows);
+				ColumnCodec::appendVarint(encoded, levels);
+				if (rows > 0) {
+					ColumnCodec::encode(store.price.data() + groupOffsets[g], rows, 1, encoded);
+					ColumnCodec::encode(store.amount.data() + groupOffsets[g], rows, 1, encoded);
+				}
+				if (levels > 0) {
+					ColumnCodec::encodeIndexes(ladderOrders.data() + ladderPosition, rows, static_cast<uint32_t>(rows), encoded);
+					ladderPosition += rows;
+				}
+			}
+			padTo(out, end, offset);
+			info.offset = offset;
+			info.size = encoded.size();
+			out.write(encoded.data(), encoded.size());
+			end = offset + info.size;
+			offset = alignUp(end);
+		}
+		appendBytes(metadata, index.data(), index.size() * sizeof(BlockInfo));
+
+		BlockFileHeader header{};
+		std::memcpy(header.magic, blockMagic, sizeof(header.magic));
+		header.version = version;
+		header.byteOrder = byteOrderMark;
+		header.rowCount = groupOffsets.back();
+		header.timestepCount = timesteps;
+		header.productCount = store.products.size();
+		header.groupCount = groupOffsets.size();
+		header.levelCount = depthOffsets.back();
+		header.blockCount = index.size();
+		header.indexSize = metadata.size();
+		header.fileSize = end;
+		header.checksum = OrderBookSnapshot::checksum(metadata.data(), metadata.size());
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(metadata.data(), metadata.size());
+		if (!out.good()) {
+			out.close();
+			std::remove(tempFilename.c_str());
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempFilename, filename, error);
+	if (error) {
+		std::remove(tempFilename.c_str());
+		return false;
+	}
+	return true;
+}
+
+SnapshotStatus BlockFile::open(const std::string& _filename) {
+	return readIndex(_filename, nullptr, nullptr, nullptr, nullptr);
+}
+
+SnapshotStatus BlockFile::open(const std::string& _filename, OrderStore& store, std::vector<size_t>& groupOffsets, std::vector<size_t>& depthOffsets,
+							   std::vector<OrderStats>& groupStats) {
+	return readIndex(_filename, &store, &groupOffsets, &depthOffsets, &groupStats);
+}
+
+SnapshotStatus BlockFile::readIndex(const std::string& _filename, OrderStore* store, std::vector<size_t>* groupOffsets, std::vector<size_t>* depthOffsets,
+									std::vector<OrderStats>* groupStats) {
+	// the header and the index are read, the blocks are left on disk until they are mapped
+	std::ifstream in{_filename, std::ios::binary};
+	if (!in.is_open()) {
+		return SnapshotStatus::missing;
+	}
+	BlockFileHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, blockMagic, sizeof(header.magic)) != 0) {
+		return SnapshotStatus::badFormat;
+	}
+	if (header.version != version || header.byteOrder != byteOrderMark) {
+		return SnapshotStatus::badVersion;
+	}
+	std::error_code error;
+	uint64_t fileSize = std::filesystem::file_size(_filename, error);
+	if (error || fileSize != header.fileSize || header.indexSize > fileSize - sizeof(header)) {
+		return SnapshotStatus::badFormat;
+	}
+	std::vector<char> metadata(static_cast<size_t>(header.indexSize));
+	if (!in.read(metadata.data(), metadata.size())) {
+		return SnapshotStatus::badFormat;
+	}
+	if (OrderBookSnapshot::checksum(metadata.data(), metadata.size()) != header.checksum) {
+		return SnapshotStatus::badChecksum;
+	}
+
+	const char* begin = metadata.data();
+	const char* end = begin + metadata.size();
+	const char* p = begin;
+	if (header.productCount > OrderStore::maxProducts) {
+		return SnapshotStatus::badFormat;
+	}
+	std::vector<std::string_view> products;
+	for (uint64_t i = 0; i < header.productCount; i++) {
+		uint32_t length;
+		if (end - p < static_cast<ptrdiff_t>(sizeof(length))) return SnapshotStatus::badFormat;
+		std::memcpy(&length, p, sizeof(length));
+		p += sizeof(length);
+		if (static_cast<uint64_t>(end - p) < length) return SnapshotStatus::badFormat;
+		products.emplace_back(p, length);
+		p += length;
+	}
+	std::vector<int64_t> timestamps;
+	std::vector<uint64_t> rowOffsets, levelOffsets;
+	std::vector<BlockInfo> index;
+	bool complete = header.timestepCount <= header.indexSize && header.groupCount <= header.indexSize // every delta takes a byte at least
+				 && ColumnCodec::decodeDeltas(p, end, static_cast<size_t>(header.timestepCount), timestamps)
+				 && ColumnCodec::decodeDeltas(p, end, static_cast<size_t>(header.groupCount), rowOffsets)
+				 && ColumnCodec::decodeDeltas(p, end, static_cast<size_t>(header.groupCount), levelOffsets);
+	if (!complete || rowOffsets.empty() || rowOffsets.back() != header.rowCount || levelOffsets.back() != header.levelCount) {
+		return SnapshotStatus::badFormat;
+	}
+	std::vector<OrderStats> stats(rowOffsets.size() - 1);
+	std::vector<size_t> filledGroups;
+	for (size_t g = 0; g + 1 < rowOffsets.size(); g++) {
+		if (rowOffsets[g + 1] < rowOffsets[g] || levelOffsets[g + 1] < levelOffsets[g]) return SnapshotStatus::badFormat;
+		if (rowOffsets[g + 1] > rowOffsets[g]) filledGroups.push_back(g);
+		stats[g].count = static_cast<size_t>(rowOffsets[g + 1] - rowOffsets[g]);
+	}
+	std::vector<double> column(filledGroups.size());
+	for (double OrderStats::* field : statFields) {
+		if (!ColumnCodec::decode(p, end, column.data(), column.size(), 1)) return SnapshotStatus::badFormat;
+		for (size_t i = 0; i < filledGroups.size(); i++) stats[filledGroups[i]].*field = column[i];
+	}
+	if (!readColumn(p, end, header.blockCount, index)) {
+		return SnapshotStatus::badFormat;
+	}
+	// the blocks follow each other through the timesteps and through the file, and hold the rows, levels and groups of their timesteps
+	uint64_t timesteps = header.timestepCount;
+	if (timesteps == 0 ? header.groupCount != 1 : (header.groupCount - 1) % timesteps != 0) {
+		return SnapshotStatus::badFormat;
+	}
+	uint64_t groupsPerStep = timesteps == 0 ? 0 : (header.groupCount - 1) / timesteps;
+	uint64_t nextStep = 0;
+	uint64_t blockEnd = sizeof(header) + header.indexSize;
+	for (size_t b = 0; b < index.size(); b++) {
+		const BlockInfo& info = index[b];
+		uint64_t lastStep = b + 1 < index.size() ? index[b + 1].firstTimestep : timesteps;
+		uint64_t firstGroup = info.firstTimestep * groupsPerStep;
+		uint64_t lastGroup = lastStep * groupsPerStep;
+		bool valid = info.firstTimestep == nextStep && lastStep > info.firstTimestep && lastStep <= timesteps
+				  && info.groupCount == lastGroup - firstGroup
+				  && info.firstRow == rowOffsets[firstGroup] && info.rowCount == rowOffsets[lastGroup] - info.firstRow
+				  && info.firstLevel == levelOffsets[firstGroup] && info.levelCount == levelOffsets[lastGroup] - info.firstLevel
+				  && info.offset % MappedFile::granularity == 0 && info.offset >= blockEnd && info.size > 0
+				  && info.offset <= fileSize && info.size <= fileSize - info.offset;
+		if (!valid) {
+			return SnapshotStatus::badFormat;
+		}
+		nextStep = lastStep;
+		blockEnd = info.offset + info.size;
+	}
+	if (nextStep != timesteps) {
+		return SnapshotStatus::badFormat;
+	}
+
+	if (store != nullptr) {
+		OrderStore loaded;
+		loaded.timestamps.reserve(timestamps.size());
+		for (std::string_view product : products) loaded.internProduct(product);
+		for (int64_t timestamp : timestamps) loaded.internTimestamp(timestamp);
+		*store = std::move(loaded);
+		groupOffsets->assign(rowOffsets.begin(), rowOffsets.end());
+		depthOffsets->assign(levelOffsets.begin(), levelOffsets.end());
+		*groupStats = std::move(stats);
+	}
+	std::lock_guard<std::mutex> lock{mutex};
+	filename = _filename;
+	blocks = std::move(index);
+	endOffset = fileSize;
+	cache.assign(blocks.size(), CacheEntry{});
+	lru.clear();
+	counters = BlockCacheCounters{};
+	lastBlock = SIZE_MAX;
+	readahead.close();
+	readaheadBlock = SIZE_MAX;
+	failureReported = false;
+	return SnapshotStatus::ok;
+}
+
+std::string BlockFile::blockFilename(const std::string& csvFilename) {
+	return csvFilename + ".blocks";
+}
+
+size_t BlockFile::getBlockCount() const {
+	return blocks.size();
+}
+
+const BlockFile::BlockInfo& BlockFile::getBlockInfo(size_t block) const {
+	return blocks[block];
+}
+
+size_t BlockFile::blockOfTimestep(size_t timestep) const {
+	auto after = std::upper_bound(blocks.begin(), blocks.end(), timestep, [](size_t t, const BlockInfo& info) { return t < info.firstTimestep; });
+	return after == blocks.begin() ? 0 : (after - blocks.begin()) - 1;
+}
+
+uint64_t BlockFile::decodedSize(size_t block) const {
+	return blocks[block].rowCount * 2 * sizeof(double) + blocks[block].levelCount * sizeof(DepthLevel);
+}
+
+std::shared_ptr<const BlockFile::Block> BlockFile::getBlock(size_t block) {
+	std::unique_lock<std::mutex> lock{mutex};
+	if (block >= blocks.size()) {
+		return nullptr;
+	}
+	CacheEntry& entry = cache[block];
+	if (entry.block) {
+		counters.hits++;
+		lru.splice(lru.begin(), lru, entry.lruPosition);
+	} else {
+		while (entry.decoding) { // another thread decodes the block, it is used once it is there
+			decodedCondition.wait(lock);
+		}
+		if (entry.block) {
+			counters.hits++;
+			lru.splice(lru.begin(), lru, entry.lruPosition);
+		} else {
+			// decoded with the mutex released, so queries on blocks in memory go on while a block is read from disk
+			auto start = std::chrono::steady_clock::now();
+			entry.decoding = true;
+			MappedFile mapping;
+			if (readaheadBlock == block) {
+				mapping = std::move(readahead);
+				readaheadBlock = SIZE_MAX;
+			}
+			lock.unlock();
+			std::shared_ptr<Block> decoded;
+			if (mapping.isOpen() || mapping.open(filename, blocks[block].offset, static_cast<size_t>(blocks[block].size))) {
+				decoded = decode(blocks[block], mapping);
+			}
+			lock.lock();
+			entry.decoding = false;
+			decodedCondition.notify_all();
+			if (!decoded) {
+				if (!failureReported) {
+					std::cerr << "Block " << block << " of " << filename << " cannot be mapped or is corrupt, queries on its timesteps fail" << std::endl;
+					failureReported = true;
+				}
+				return nullptr;
+			}
+			entry.block = decoded;
+			lru.push_front(block);
+			entry.lruPosition = lru.begin();
+			counters.loads++;
+			counters.residentBytes += static_cast<size_t>(decodedSize(block));
+			counters.encodedBytes += blocks[block].size;
+			counters.decodedBytes += decodedSize(block);
+			counters.decodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	size_t next = blocks.size();
+	if (block == lastBlock + 1 && block + 1 < blocks.size()) { // moving forward block by block, the next block is read in while this one is used
+		next = block + 1;
+		if (!cache[next].block && !cache[next].decoding && readaheadBlock != next
+			&& readahead.open(filename, blocks[next].offset, static_cast<size_t>(blocks[next].size))) {
+			readahead.willNeed();
+			readaheadBlock = next;
+			counters.readaheads++;
+		}
+	}
+	lastBlock = block;
+	std::shared_ptr<const Block> found = entry.block;
+	evict(block, next);
+	return found;
+}
+
+std::shared_ptr<BlockFile::Block> BlockFile::decode(const BlockInfo& info, const MappedFile& source) {
+	std::shared_ptr<Block> decoded = std::make_shared<Block>();
+	size_t rowCount = static_cast<size_t>(info.rowCount);
+	size_t levelCount = static_cast<size_t>(info.levelCount);
+	decoded->rows.resize(rowCount * 2);
+	decoded->ladders.reserve(levelCount);
+	double* prices = decoded->rows.data();
+	double* amounts = prices + rowCount;
+	const char* p = source.data();
+	const char* end = p + source.size();
+	std::vector<uint32_t> order;
+	size_t row = 0;
+	bool complete = true;
+	for (uint64_t g = 0; g < info.groupCount && complete; g++) { // the ladders are summed in the order they were when the file was written
+		uint64_t rows, levels;
+		complete = ColumnCodec::readVarint(p, end, rows) && ColumnCodec::readVarint(p, end, levels)
+				&& rows <= rowCount - row && levels <= rows
+				&& (rows == 0 || (ColumnCodec::decode(p, end, prices + row, static_cast<size_t>(rows), 1)
+								  && ColumnCodec::decode(p, end, amounts + row, static_cast<size_t>(rows), 1)));
+		if (complete && levels > 0) {
+			order.resize(static_cast<size_t>(rows));
+			complete = ColumnCodec::decodeIndexes(p, end, order.data(), order.size(), static_cast<uint32_t>(rows))
+					&& DepthLadder::build(prices + row, amounts + row, order.data(), order.size(), decoded->ladders) == levels;
+		}
+		row += static_cast<size_t>(rows);
+	}
+	if (!complete || row != rowCount || decoded->ladders.size() != levelCount) {
+		return nullptr;
+	}
+	decoded->prices = prices;
+	decoded->amounts = amounts;
+	decoded->levels = decoded->ladders.data();
+	decoded->firstRow = static_cast<size_t>(info.firstRow);
+	decoded->firstLevel = static_cast<size_t>(info.firstLevel);
+	return decoded;
+}
+
+void BlockFile::evict(size_t keep, size_t keepNext) {
+	// from the least recently used end, a block that cannot go is stepped over
+	auto position = lru.end();
+	while (counters.residentBytes > pageBudget && position != lru.begin()) {
+		--position;
+		size_t b = *position;
+		bool pinned = b == keep || b == keepNext || cache[b].block.use_count() > 1; // a held block stays in memory for its holder anyway
+		if (pinned) {
+			continue;
+		}
+		counters.residentBytes -= static_cast<size_t>(decodedSize(b));
+		cache[b].block.reset();
+		position = lru.erase(position);
+		counters.evictions++;
+	}
+}
+
+BlockCacheCounters BlockFile::getCounters() {
+	std::lock_guard<std::mutex> lock{mutex};
+	return counters;
+}
+
+size_t BlockFile::getPageBudget() const {
+	return pageBudget;
+}
+
+uint64_t BlockFile::getBlockBytes() const {
+	return blocks.empty() ? 0 : endOffset - blocks.front().offset;
+}
+
+uint64_t BlockFile::getDecodedBytes() const {
+	uint64_t bytes = 0;
+	for (size_t b = 0; b < blocks.size(); b++) bytes += decodedSize(b);
+	return bytes;
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include "DepthLadder.h"
+#include "MappedFile.h"
+#include "OrderBookSnapshot.h"
+#include "OrderStore.h"
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct OrderStats;
+
+/** Work of the block cache of an out of core OrderBook */
+struct BlockCacheCounters {
+	/** lookups of a block that was already decoded */
+	uint64_t hits = 0;
+	/** blocks decoded because a query needed them */
+	uint64_t loads = 0;
+	/** blocks mapped ahead of the cursor because the blocks before them were asked for in order, they are decoded when asked for */
+	uint64_t readaheads = 0;
+	/** blocks dropped to stay within the page budget */
+	uint64_t evictions = 0;
+	/** bytes of the decoded blocks held now */
+	size_t residentBytes = 0;
+	/** bytes of the blocks decoded so far, in the file and once decoded. Their ratio is the compression ratio */
+	uint64_t encodedBytes = 0;
+	uint64_t decodedBytes = 0;
+	/** time spent mapping and decoding blocks, including reading them from disk */
+	double decodeSeconds = 0;
+};
+
+/** The rows of an OrderBook on disk for out of core books: blocks of whole timesteps, each holding the compressed price and amount
+	columns of its groups (see ColumnCodec) and the ladder order of their rows, with a block index in front. The depth ladders are
+	not stored, they are built again from the decoded rows in that order. Only the dictionaries and the index are read when the
+	file is opened. Blocks are mapped and decoded one by one when a query needs them and dropped least recently used first once
+	the decoded blocks hold more than the page budget. Safe to use from many threads */
+class BlockFile {
+	public:
+		/** where a block is and what it holds */
+		struct BlockInfo {
+			uint64_t firstTimestep;
+			uint64_t firstRow;
+			uint64_t rowCount;
+			uint64_t firstLevel;
+			uint64_t levelCount;
+			uint64_t groupCount;
+			uint64_t offset;
+			/** bytes of the encoded block */
+			uint64_t size;
+		};
+		/** a block decoded into memory. It stays in memory while it is held, even after the cache drops it */
+		struct Block {
+			/** the price column followed by the amount column */
+			std::vector<double> rows;
+			/** level firstLevel is ladders[0] */
+			std::vector<DepthLevel> ladders;
+			/** row firstRow is prices[0] and amounts[0] */
+			const double* prices = nullptr;
+			const double* amounts = nullptr;
+			const DepthLevel* levels = nullptr;
+			size_t firstRow = 0;
+			size_t firstLevel = 0;
+		};
+
+		/** pageBudget is the number of bytes of decoded blocks kept in memory */
+		explicit BlockFile(size_t _pageBudget);
+		/** writes the rows of store, grouped as in groupOffsets, to filename, replacing it. Groups with depth levels in depthOffsets
+			have the ladder order of their rows (see DepthLadder::sortOrder) in ladderOrders, one group after the other.
+			The statistics of every group go in the index, so opening the file does not decode the blocks to compute them.
+			Returns false if the file cannot be written */
+		static bool write(const std::string& filename,
+						  const OrderStore& store,
+						  const std::vector<size_t>& groupOffsets,
+						  const std::vector<size_t>& depthOffsets,
+						  const std::vector<uint32_t>& ladderOrders,
+						  const std::vector<OrderStats>& groupStats);
+		/** opens filename, reading its block index */
+		SnapshotStatus open(const std::string& filename);
+		/** opens filename and reads its dictionaries into store, its group and depth offsets and the statistics of its groups.
+			They are left untouched unless ok is returned */
+		SnapshotStatus open(const std::string& filename, OrderStore& store, std::vector<size_t>& groupOffsets, std::vector<size_t>& depthOffsets,
+							std::vector<OrderStats>& groupStats);
+		/** returns the file name of the block file kept next to a csv file */
+		static std::string blockFilename(const std::string& csvFilename);
+
+		size_t getBlockCount() const;
+		const BlockInfo& getBlockInfo(size_t block) const;
+		/** the block holding the sent timestep, binary search over the block index */
+		size_t blockOfTimestep(size_t timestep) const;
+		/** the sent block, decoding it if it is not in memory. When the blocks are asked for in order the next block is mapped
+			and read ahead too. Returns nullptr if the block cannot be mapped or is corrupt */
+		std::shared_ptr<const Block> getBlock(size_t block);
+		BlockCacheCounters getCounters();
+		size_t getPageBudget() const;
+		/** bytes of the file that hold blocks, with the padding between them */
+		uint64_t getBlockBytes() const;
+		/** bytes the blocks hold once decoded */
+		uint64_t getDecodedBytes() const;
+
+		/** bumped whenever the layout changes, older block files are then rejected and written again */
+		static const uint32_t version = 5;
+		/** blocks are closed once their decoded columns reach this size, a block holds at least one timestep */
+		static const size_t targetBlockBytes = 1024 * 1024;
+
+	private:
+		struct CacheEntry {
+			std::shared_ptr<const Block> block;
+			/** a thread is decoding the block with mutex released, the others wait on decodedCondition for it */
+			bool decoding = false;
+			/** where the block is in lru while it is decoded */
+			std::list<size_t>::iterator lruPosition;
+		};
+		SnapshotStatus readIndex(const std::string& filename, OrderStore* store, std::vector<size_t>* groupOffsets, std::vector<size_t>* depthOffsets,
+								 std::vector<OrderStats>* groupStats);
+		/** bytes of the block once decoded */
+		uint64_t decodedSize(size_t block) const;
+		/** decodes the mapped block, nullptr if it is corrupt. Runs without mutex held */
+		static std::shared_ptr<Block> decode(const BlockInfo& info, const MappedFile& source);
+		/** drops the least recently used blocks that nobody holds until the decoded blocks fit the budget, keeping the sent ones */
+		void evict(size_t keep, size_t keepNext);
+
+		std::string filename;
+		std::vector<BlockInfo> blocks;
+		uint64_t endOffset;
+		size_t pageBudget;
+		std::vector<CacheEntry> cache;
+		/** the decoded blocks, most recently used first */
+		std::list<size_t> lru;
+		BlockCacheCounters counters;
+		/** the block asked for last, to see the cursor moving forward */
+		size_t lastBlock;
+		/** the block mapped ahead of the cursor and not decoded yet, readaheadBlock is SIZE_MAX when there is none */
+		MappedFile readahead;
+		size_t readaheadBlock;
+		/** a block that cannot be mapped or is corrupt is reported on std::cerr once per file, each query gets nullptr for it */
+		bool failureReported;
+		std::mutex mutex;
+		/** signalled when a block finished decoding */
+		std::condition_variable decodedCondition;
+};
@@ -1,91 +1,252 @@
-#include "CSVReader.h"
-#include <iostream>
-#include <fstream>
-
-CSVReader::CSVReader() {
-
-
-}
-
-
-	
-std::vector<OrderBookEntry> CSVReader::readCSV(std::string csvFilename) {
-	std::vector<OrderBookEntry> entries;
-
-	std::ifstream csvFile{csvFilename};
-	std::string line;
-
-
-	if (csvFile.is_open()) {
-		while (std::getline(csvFile,line)) {
-			try {
-				OrderBookEntry obe = stringsToOBE(tokenise(line, ','));
-				entries.push_back(obe);
-			} catch (const std::exception& e) {
-				//
-			}
-		}// end of while loop
-	}
-	//std::cout << "There are " << entries.size() << " lines of entries in the dataset successfully read" << std::endl;
-	return entries;
-}
-
-	
-std::vector<std::string> CSVReader::tokenise(std::string csvLine, char separator) {
-	std::vector<std::string> tokens;
-	signed int start, end;
-	std::string token;
-		start = csvLine.find_first_not_of(separator, 0);
-		do {
-			end = csvLine.find_first_of(separator, start);
-			if (start == csvLine.length() || start == end) break;
-			if (end >= 0) token = csvLine.substr(start, end - start);
-			else token = csvLine.substr(start, csvLine.length() - start);
-			tokens.push_back(token);
-		start = end + 1;
-
-		} while (end > 0);
-		return tokens;
-}
-
-OrderBookEntry CSVReader::stringsToOBE(std::vector<std::string> tokens) {
-	double price, amount;
-	if(tokens.size() != 5){
-		throw std::exception{};
-	}
-	try {
-		price = std::stod(tokens[3]);
-		amount = std::stod(tokens[4]);
-	} catch (const std::exception& e) {
-		throw;
-	}
-
-
-	OrderBookEntry obe{price,
-					   amount,
-					   tokens[0],
-					   tokens[1],
-					   OrderBookEntry::stringToOrderBookType(tokens[2])};
-	return obe;
-}
-
-OrderBookEntry CSVReader::stringsToOBE(std::string priceString,
-											  std::string amountString,
-											  std::string timestamp,
-											  std::string product,
-											  OrderBookType orderType) {
-	double price, amount;
-	try {
-		price = std::stod(priceString);
-		amount = std::stod(amountString);
-	}
-	catch (const std::exception& e) {
-		throw;
-	}
-	OrderBookEntry obe{ price,
-					   amount,
-					   timestamp,
-					   product,
-					   orderType};
-	return obe;
+#include "CSVReader.h"
+#include "MappedFile.h"
+#include "Timestamp.h"
+#include <iostream>
+#include <fstream>
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+CSVReader::CSVReader() {
+
+
+}
+
+
+	
+std::vector<OrderBookEntry> CSVReader::readCSV(std::string csvFilename) {
+	std::vector<OrderBookEntry> entries;
+
+	MappedFile csvFile{csvFilename};
+	std::vector<CSVRow> rows;
+	parseCSV(csvFile.view(), rows);
+
+	entries.reserve(rows.size());
+	for (const CSVRow& row : rows) {
+		entries.emplace_back(row.price,
+							 row.amount,
+							 row.timestamp,
+							 std::string(row.product),
+							 row.orderType);
+	}
+	//std::cout << "There are " << entries.size() << " lines of entries in the dataset successfully read" << std::endl;
+	return entries;
+}
+
+CSVParseResult CSVReader::parseCSV(std::string_view text, std::vector<CSVRow>& rows) { // walks the text line by line without copying it
+	CSVParseResult result;
+	result.opened = true;
+	const char* p = text.data();
+	const char* end = p + text.size();
+	CSVRow row{};
+
+	while (p < end) {
+		const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (eol == nullptr) eol = end;
+		std::string_view line{p, static_cast<size_t>(eol - p)};
+		p = eol + 1;
+		result.lines++;
+
+		if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+		if (line.find_first_not_of(" \t") == std::string_view::npos) continue; // blank lines are not rows, but are not errors either
+
+		if (parseLine(line, row)) {
+			rows.push_back(row);
+			result.rows++;
+		} else {
+			if (result.badLines == 0) result.firstBadLine = result.lines;
+			result.badLines++;
+		}
+	}
+	return result;
+}
+
+CSVParseResult CSVReader::parseCSV(std::string_view text, std::vector<CSVRow>& rows, unsigned int threads) {
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+	size_t chunkCount = std::min<size_t>(threads, text.size() / minChunkBytes + 1);
+	if (chunkCount <= 1) {
+		return parseCSV(text, rows);
+	}
+
+	// every chunk is parsed into its own buffer, and the buffers are joined in file order afterwards
+	std::vector<std::string_view> chunks = splitLines(text, chunkCount);
+	std::vector<std::vector<CSVRow>> chunkRows(chunks.size());
+	std::vector<CSVParseResult> chunkResults(chunks.size());
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < chunks.size(); i++) {
+		workers.emplace_back([&chunks, &chunkRows, &chunkResults, i]() {
+			chunkResults[i] = parseCSV(chunks[i], chunkRows[i]);
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	CSVParseResult result;
+	result.opened = true;
+	size_t total = rows.size();
+	for (const std::vector<CSVRow>& chunk : chunkRows) total += chunk.size();
+	rows.reserve(total);
+	for (size_t i = 0; i < chunks.size(); i++) {
+		const CSVParseResult& chunk = chunkResults[i];
+		if (result.badLines == 0 && chunk.badLines > 0) {
+			result.firstBadLine = result.lines + chunk.firstBadLine; // line numbers of a chunk start after the lines of the chunks before it
+		}
+		result.lines += chunk.lines;
+		result.rows += chunk.rows;
+		result.badLines += chunk.badLines;
+		rows.insert(rows.end(), chunkRows[i].begin(), chunkRows[i].end());
+	}
+	return result;
+}
+
+std::vector<std::string_view> CSVReader::splitLines(std::string_view text, size_t count) {
+	std::vector<std::string_view> chunks;
+	size_t start = 0;
+	for (size_t i = 1; i <= count && start < text.size(); i++) {
+		size_t end = text.size();
+		if (i < count) {
+			size_t lineBreak = text.find('\n', std::max(start, text.size() / count * i));
+			if (lineBreak != std::string_view::npos) end = lineBreak + 1;
+		}
+		chunks.push_back(text.substr(start, end - start));
+		start = end;
+	}
+	return chunks;
+}
+
+size_t CSVReader::completeTimestepsLength(std::string_view text) {
+	size_t end = text.rfind('\n');
+	if (end == std::string_view::npos) {
+		return 0;
+	}
+	// walks back over the lines that start with the timestamp of the last complete line
+	std::string_view lastTimestamp;
+	size_t lineEnd = end;
+	while (lineEnd > 0) {
+		size_t lineStart = text.rfind('\n', lineEnd - 1);
+		lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+		std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+		std::string_view timestamp = line.substr(0, line.find(','));
+		if (lastTimestamp.empty()) {
+			lastTimestamp = timestamp;
+		} else if (timestamp != lastTimestamp && !line.empty() && line != "\r") {
+			return lineEnd + 1;
+		}
+		lineEnd = lineStart == 0 ? 0 : lineStart - 1;
+	}
+	return 0;
+}
+
+bool CSVReader::parseLine(std::string_view line, CSVRow& row) {
+	std::string_view fields[5];
+	size_t count = 0;
+	size_t start = 0;
+	while (true) {
+		size_t comma = line.find(',', start);
+		if (count == 5) return false; // too many fields
+		fields[count++] = line.substr(start, comma == std::string_view::npos ? std::string_view::npos : comma - start);
+		if (comma == std::string_view::npos) break;
+		start = comma + 1;
+	}
+	if (count != 5 || fields[0].empty() || fields[1].empty()) {
+		return false;
+	}
+	if (!parseDouble(fields[3], row.price) || !parseDouble(fields[4], row.amount) || !Timestamp::parse(fields[0], row.timestamp)) {
+		return false;
+	}
+	row.product = fields[1];
+	if (fields[2] == "ask") {
+		row.orderType = OrderBookType::ask;
+	} else if (fields[2] == "bid") {
+		row.orderType = OrderBookType::bid;
+	} else {
+		row.orderType = OrderBookType::unknown;
+	}
+	return true;
+}
+
+bool CSVReader::parseDouble(std::string_view field, double& value) { // accepts surrounding spaces like std::stod, but nothing else around the number
+	size_t first = field.find_first_not_of(' ');
+	if (first == std::string_view::npos) return false;
+	const char* begin = field.data() + first;
+	const char* end = field.data() + field.size();
+	if (*begin == '+') begin++; // from_chars does not take a leading plus
+	std::from_chars_result parsed = std::from_chars(begin, end, value);
+	if (parsed.ec != std::errc{}) return false;
+	for (const char* c = parsed.ptr; c < end; c++) {
+		if (*c != ' ') return false;
+	}
+	return true;
+}
+
+	
+std::vector<std::string> CSVReader::tokenise(std::string csvLine, char separator) {
+	std::vector<std::string> tokens;
+	signed int start, end;
+	std::string token;
+		start = csvLine.find_first_not_of(separator, 0);
+		do {
+			end = csvLine.find_first_of(separator, start);
+			if (start == csvLine.length() || start == end) break;
+			if (end >= 0) token = csvLine.substr(start, end - start);
+			else token = csvLine.substr(start, csvLine.length() - start);
+			tokens.push_back(token);
+		start = end + 1;
+
+		} while (end > 0);
+		return tokens;
+}
+
+OrderBookEntry CSVReader::stringsToOBE(std::vector<std::string> tokens) {
+	double price, amount;
+	if(tokens.size() != 5){
+		throw std::exception{};
+	}
+	try {
+		price = std::stod(tokens[3]);
+		amount = std::stod(tokens[4]);
+	} catch (const std::exception& e) {
+		throw;
+	}
+	int64_t timestamp;
+	if (!Timestamp::parse(tokens[0], timestamp)) {
+		throw std::exception{};
+	}
+
+
+	OrderBookEntry obe{price,
+					   amount,
+					   timestamp,
+					   tokens[1],
+					   OrderBookEntry::stringToOrderBookType(tokens[2])};
+	return obe;
+}
+
+OrderBookEntry CSVReader::stringsToOBE(std::string priceString,
+											  std::string amountString,
+											  std::string timestamp,
+											  std::string product,
+											  OrderBookType orderType) {
+	double price, amount;
+	try {
+		price = std::stod(priceString);
+		amount = std::stod(amountString);
+	}
+	catch (const std::exception& e) {
+		throw;
+	}
+	int64_t time;
+	if (!Timestamp::parse(timestamp, time)) {
+		throw std::exception{};
+	}
+	OrderBookEntry obe{ price,
+					   amount,
+					   time,
+					   product,
+					   orderType};
+	return obe;
 }
\ No newline at end of file
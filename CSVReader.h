@@ -1,20 +1,63 @@
-#pragma once
-
-#include "OrderBookEntry.h"
-#include <vector>
-#include <string>
-
-class CSVReader {
-	public:
-	 CSVReader();
-	 static std::vector<OrderBookEntry> readCSV(std::string csvFile);
-	 static std::vector<std::string> tokenise(std::string csvLine, char separator);
-	 static OrderBookEntry stringsToOBE(std::string price, 
-										std::string amount,
-										std::string timestamp,
-										std::string product,
-										OrderBookType OrderBookType);
-
-	private:
-	 static OrderBookEntry stringsToOBE(std::vector<std::string> strings);
-};
+#pragma once
+
+#include "OrderBookEntry.h"
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <string_view>
+
+/** One row parsed by CSVReader::parseCSV. The strings are views into the parsed text */
+struct CSVRow {
+	/** microseconds since 1970/01/01 00:00:00, see Timestamp */
+	int64_t timestamp;
+	std::string_view product;
+	OrderBookType orderType;
+	double price;
+	double amount;
+};
+
+/** Outcome of CSVReader::parseCSV. Bad lines are counted rather than thrown */
+struct CSVParseResult {
+	/** false if the file could not be opened */
+	bool opened = false;
+	/** number of lines seen, including bad ones */
+	size_t lines = 0;
+	/** number of rows parsed into the output */
+	size_t rows = 0;
+	/** number of lines skipped because they did not have 5 fields or a valid timestamp, price and amount */
+	size_t badLines = 0;
+	/** 1-based line number of the first bad line, 0 if there were none */
+	size_t firstBadLine = 0;
+};
+
+class CSVReader {
+	public:
+	 CSVReader();
+	 static std::vector<OrderBookEntry> readCSV(std::string csvFile);
+	 static std::vector<std::string> tokenise(std::string csvLine, char separator);
+	 static OrderBookEntry stringsToOBE(std::string price, 
+										std::string amount,
+										std::string timestamp,
+										std::string product,
+										OrderBookType OrderBookType);
+
+	 /** parses csv text in the timestamp,product,type,price,amount format, appending its rows to the sent vector.
+		 The rows point into text, which has to outlive them */
+	 static CSVParseResult parseCSV(std::string_view text, std::vector<CSVRow>& rows);
+	 /** parses like parseCSV, splitting the text at line boundaries into one chunk per thread. Rows are appended in file order.
+		 threads = 0 uses one thread per hardware thread */
+	 static CSVParseResult parseCSV(std::string_view text, std::vector<CSVRow>& rows, unsigned int threads);
+	 /** parses one line without its line ending, returns false if it is not a valid row */
+	 static bool parseLine(std::string_view line, CSVRow& row);
+	 /** length of the start of text that holds complete lines of every timestamp but the last one.
+		 The rest may still be written to by a feed that appends a timestep at a time */
+	 static size_t completeTimestepsLength(std::string_view text);
+
+	private:
+	 static OrderBookEntry stringsToOBE(std::vector<std::string> strings);
+	 /** splits text into at most count pieces of similar size, each ending after a line break or at the end of the text */
+	 static std::vector<std::string_view> splitLines(std::string_view text, size_t count);
+	 /** texts smaller than this per thread are not worth a thread of their own */
+	 static const size_t minChunkBytes = 1 << 20;
+	 static bool parseDouble(std::string_view field, double& value);
+};
@@ -0,0 +1,120 @@
+#include "CSVTail.h"
+#include "CSVReader.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+CSVTail::CSVTail(OrderBook& _orderBook, std::string _filename, std::chrono::milliseconds _pollInterval, std::chrono::milliseconds _settleTime)
+	: orderBook(_orderBook),
+	  filename(_filename),
+	  pollInterval(_pollInterval),
+	  settleTime(_settleTime),
+	  offset(_orderBook.getLoadedBytes()),
+	  lastGrowth(std::chrono::steady_clock::now()),
+	  reportedShrink(false),
+	  timestepsAdded(0),
+	  rowsAdded(0),
+	  rowsSkipped(0),
+	  running(false) {
+
+}
+
+CSVTail::~CSVTail() {
+	stop();
+}
+
+void CSVTail::start() {
+	std::lock_guard<std::mutex> lock{runningMutex};
+	if (running) return;
+	running = true;
+	thread = std::thread{[this] {
+		std::unique_lock<std::mutex> lock{runningMutex};
+		while (running) {
+			lock.unlock();
+			poll();
+			lock.lock();
+			runningCondition.wait_for(lock, pollInterval, [this] { return !running; });
+		}
+	}};
+}
+
+void CSVTail::stop() {
+	{
+		std::lock_guard<std::mutex> lock{runningMutex};
+		running = false;
+	}
+	runningCondition.notify_all();
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+size_t CSVTail::poll() {
+	std::error_code error;
+	size_t size = static_cast<size_t>(std::filesystem::file_size(filename, error));
+	if (error) {
+		return 0;
+	}
+	auto now = std::chrono::steady_clock::now();
+	if (size < offset) { // rewritten rather than appended to, what the book holds no longer matches the file
+		if (!reportedShrink) {
+			std::cerr << filename << " shrank, no longer following it" << std::endl;
+			reportedShrink = true;
+		}
+		return 0;
+	}
+	if (size > offset) {
+		std::ifstream file{filename, std::ios::binary};
+		file.seekg(static_cast<std::streamoff>(offset));
+		size_t before = pending.size();
+		pending.resize(before + (size - offset));
+		file.read(&pending[before], static_cast<std::streamsize>(size - offset));
+		pending.resize(before + static_cast<size_t>(file.gcount()));
+		offset += static_cast<size_t>(file.gcount());
+		lastGrowth = now;
+	}
+
+	// a partly written last line waits for its line break, the newest timestamp waits for a newer one or for the file to settle
+	std::string_view text = pending;
+	size_t lineBreak = text.rfind('\n');
+	text = text.substr(0, lineBreak == std::string_view::npos ? 0 : lineBreak + 1);
+	if (now - lastGrowth < settleTime) {
+		text = text.substr(0, CSVReader::completeTimestepsLength(text));
+	}
+	if (text.empty()) {
+		return 0;
+	}
+
+	std::vector<CSVRow> rows;
+	CSVParseResult result = CSVReader::parseCSV(text, rows);
+	if (result.badLines > 0) {
+		std::cerr << "Skipped " << result.badLines << " malformed lines appended to " << filename << std::endl;
+	}
+	auto byTimestamp = [](const CSVRow& a, const CSVRow& b) { return a.timestamp < b.timestamp; };
+	if (!std::is_sorted(rows.begin(), rows.end(), byTimestamp)) { // rows written out of order still go to their own timestep
+		std::stable_sort(rows.begin(), rows.end(), byTimestamp);
+	}
+
+	size_t added = 0;
+	size_t skipped = 0;
+	for (size_t first = 0; first < rows.size();) {
+		size_t last = first + 1;
+		while (last < rows.size() && rows[last].timestamp == rows[first].timestamp) last++;
+		if (orderBook.appendTimestep(&rows[first], last - first)) {
+			added++;
+			rowsAdded += last - first;
+		} else {
+			skipped += last - first;
+		}
+		first = last;
+	}
+	if (skipped > 0) {
+		std::cerr << "Skipped " << skipped << " rows appended to " << filename << " for timesteps that were already added or had too many new products" << std::endl;
+		rowsSkipped += skipped;
+	}
+	timestepsAdded += added;
+	pending.erase(0, text.size());
+	return added;
+}
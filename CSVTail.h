@@ -0,0 +1,55 @@
+#pragma once
+#include "OrderBook.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/** Follows a csv file that a feed keeps appending to, adding each new timestep to an OrderBook loaded with follow.
+	Only complete lines are parsed. A timestep is added once a line with a newer timestamp follows it,
+	or once the file has stopped growing for the settle time. Rows arriving later for a timestep already added are skipped */
+class CSVTail {
+	public:
+		CSVTail(OrderBook& _orderBook,
+				std::string _filename,
+				std::chrono::milliseconds _pollInterval = std::chrono::milliseconds{200},
+				std::chrono::milliseconds _settleTime = std::chrono::milliseconds{1000});
+		~CSVTail();
+		CSVTail(const CSVTail&) = delete;
+		CSVTail& operator=(const CSVTail&) = delete;
+
+		/** polls the file every poll interval on a thread of its own */
+		void start();
+		/** stops the thread started by start() */
+		void stop();
+		/** reads what was appended to the file since the last call and adds the timesteps that are complete. Returns the number added */
+		size_t poll();
+
+		/** totals since construction */
+		size_t getTimestepsAdded() const { return timestepsAdded; }
+		size_t getRowsAdded() const { return rowsAdded; }
+		size_t getRowsSkipped() const { return rowsSkipped; }
+
+	private:
+		OrderBook& orderBook;
+		std::string filename;
+		std::chrono::milliseconds pollInterval;
+		std::chrono::milliseconds settleTime;
+		/** bytes of the file read so far */
+		size_t offset;
+		/** text read from the file whose timesteps were not added yet */
+		std::string pending;
+		std::chrono::steady_clock::time_point lastGrowth;
+		bool reportedShrink;
+
+		std::atomic<size_t> timestepsAdded;
+		std::atomic<size_t> rowsAdded;
+		std::atomic<size_t> rowsSkipped;
+
+		std::thread thread;
+		bool running;
+		std::mutex runningMutex;
+		std::condition_variable runningCondition;
+};
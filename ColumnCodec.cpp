@@ -0,0 +1,230 @@
+#include "ColumnCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+	/** integers up to 2^53 are exact doubles */
+	const double exactIntegerLimit = 9007199254740992.0;
+	/** widest packed value, a value and its bit offset in a byte fit one 64 bit load */
+	const unsigned int maxPackedBits = 56;
+
+	uint64_t bitsOf(double value) {
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	double fromBits(uint64_t bits) {
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	/** bits needed to write value */
+	unsigned int bitWidth(uint64_t value) {
+		unsigned int width = 0;
+		while (value != 0) {
+			value >>= 1;
+			width++;
+		}
+		return width;
+	}
+
+	/** bytes of bits left once its leading zero bytes are dropped */
+	unsigned int significantBytes(uint64_t bits) {
+		return (bitWidth(bits) + 7) / 8;
+	}
+
+	size_t packedBytes(size_t count, unsigned int width) {
+		return (count * width + 7) / 8;
+	}
+
+	/** appends count values of width bits each, value(i) gives value i */
+	template <typename Value>
+	void pack(std::vector<char>& out, size_t count, unsigned int width, Value value) {
+		size_t start = out.size();
+		out.resize(start + packedBytes(count, width), '\0');
+		char* data = out.data() + start;
+		for (size_t i = 0; i < count; i++) {
+			uint64_t bits = value(i);
+			for (size_t bit = i * width; bits != 0; bit += 8 - bit % 8) {
+				data[bit / 8] = static_cast<char>(static_cast<uint8_t>(data[bit / 8]) | static_cast<uint8_t>(bits << (bit % 8)));
+				bits >>= 8 - bit % 8;
+			}
+		}
+	}
+
+	/** value i of width bits packed from data, reading no further than end */
+	inline uint64_t unpack(const char* data, const char* end, size_t i, unsigned int width, uint64_t mask) {
+		size_t bit = i * width;
+		const char* first = data + bit / 8;
+		uint64_t word = 0;
+		if (end - first >= 8) {
+			std::memcpy(&word, first, sizeof(word)); // packed values are read as little endian words
+		} else {
+			for (ptrdiff_t b = 0; b < end - first; b++) word |= static_cast<uint64_t>(static_cast<uint8_t>(first[b])) << (8 * b);
+		}
+		return (word >> (bit % 8)) & mask;
+	}
+}
+
+void ColumnCodec::appendVarint(std::vector<char>& out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<char>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<char>(value));
+}
+
+bool ColumnCodec::readVarint(const char*& p, const char* end, uint64_t& value) {
+	value = 0;
+	for (unsigned int shift = 0; p < end && shift < 64; shift += 7) {
+		uint8_t byte = static_cast<uint8_t>(*p++);
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+void ColumnCodec::encodeIndexes(const uint32_t* values, size_t count, uint32_t limit, std::vector<char>& out) {
+	unsigned int width = bitWidth(limit == 0 ? 0 : limit - 1);
+	pack(out, count, width, [values](size_t i) { return values[i]; });
+}
+
+bool ColumnCodec::decodeIndexes(const char*& p, const char* end, uint32_t* values, size_t count, uint32_t limit) {
+	unsigned int width = bitWidth(limit == 0 ? 0 : limit - 1);
+	uint64_t mask = (1ull << width) - 1;
+	if (static_cast<size_t>(end - p) < packedBytes(count, width)) return false;
+	for (size_t i = 0; i < count; i++) {
+		uint64_t value = unpack(p, end, i, width, mask);
+		if (value >= limit) return false;
+		values[i] = static_cast<uint32_t>(value);
+	}
+	p += packedBytes(count, width);
+	return true;
+}
+
+int ColumnCodec::findScale(const double* values, size_t count, size_t stride) {
+	for (int scale = 0; scale <= maxScale; scale++) {
+		double power = powersOfTen[scale];
+		bool exact = true;
+		for (size_t i = 0; i < count && exact; i++) {
+			double value = values[i * stride];
+			double scaled = std::nearbyint(value * power);
+			// the bits are compared, so -0 and nan are left to the other encodings
+			exact = std::fabs(scaled) < exactIntegerLimit && bitsOf(scaled / power) == bitsOf(value);
+		}
+		if (exact) return scale;
+	}
+	return -1;
+}
+
+void ColumnCodec::encodeScaled(const double* values, size_t count, size_t stride, int scale, std::vector<char>& out) {
+	// the scale, the smallest integer and the width, then the distance of every integer from the smallest
+	double power = powersOfTen[scale];
+	std::vector<int64_t> integers(count);
+	for (size_t i = 0; i < count; i++) integers[i] = static_cast<int64_t>(std::nearbyint(values[i * stride] * power));
+	int64_t base = count == 0 ? 0 : *std::min_element(integers.begin(), integers.end());
+	uint64_t largest = 0;
+	for (int64_t integer : integers) largest = std::max(largest, static_cast<uint64_t>(integer - base));
+	unsigned int width = bitWidth(largest); // at most 54, as the integers are within +-2^53
+	out.push_back(static_cast<char>(Method::scaled));
+	out.push_back(static_cast<char>(scale));
+	appendVarint(out, zigzag(base));
+	out.push_back(static_cast<char>(width));
+	pack(out, count, width, [&integers, base](size_t i) { return static_cast<uint64_t>(integers[i] - base); });
+}
+
+void ColumnCodec::encodeXor(const double* values, size_t count, size_t stride, std::vector<char>& out) {
+	// values go in pairs behind one byte holding the number of bytes kept of each, low bytes first
+	out.push_back(static_cast<char>(Method::xorBytes));
+	uint64_t previous = 0;
+	for (size_t i = 0; i < count; i += 2) {
+		uint64_t first = bitsOf(values[i * stride]) ^ previous;
+		previous ^= first;
+		uint64_t second = 0;
+		if (i + 1 < count) {
+			second = bitsOf(values[(i + 1) * stride]) ^ previous;
+			previous ^= second;
+		}
+		unsigned int firstBytes = significantBytes(first);
+		unsigned int secondBytes = significantBytes(second);
+		out.push_back(static_cast<char>(firstBytes | secondBytes << 4));
+		for (unsigned int b = 0; b < firstBytes; b++) out.push_back(static_cast<char>(first >> (8 * b)));
+		for (unsigned int b = 0; b < secondBytes; b++) out.push_back(static_cast<char>(second >> (8 * b)));
+	}
+}
+
+void ColumnCodec::encode(const double* values, size_t count, size_t stride, std::vector<char>& out) {
+	// every encoding that applies is tried and the shortest kept, blocks are written once and read many times
+	size_t start = out.size();
+	int scale = findScale(values, count, stride);
+	std::vector<char> candidate;
+	if (scale >= 0) {
+		encodeScaled(values, count, stride, scale, out);
+	}
+	encodeXor(values, count, stride, candidate);
+	if (scale < 0 || candidate.size() < out.size() - start) {
+		out.resize(start);
+		out.insert(out.end(), candidate.begin(), candidate.end());
+	}
+	if (out.size() - start > 1 + count * sizeof(double)) {
+		out.resize(start);
+		out.push_back(static_cast<char>(Method::raw));
+		for (size_t i = 0; i < count; i++) {
+			const char* bytes = reinterpret_cast<const char*>(values + i * stride);
+			out.insert(out.end(), bytes, bytes + sizeof(double));
+		}
+	}
+}
+
+bool ColumnCodec::decode(const char*& p, const char* end, double* values, size_t count, size_t stride) {
+	if (p >= end) return false;
+	Method method = static_cast<Method>(*p++);
+	if (method == Method::raw) {
+		if (static_cast<size_t>(end - p) / sizeof(double) < count) return false;
+		for (size_t i = 0; i < count; i++) {
+			std::memcpy(values + i * stride, p, sizeof(double));
+			p += sizeof(double);
+		}
+		return true;
+	}
+	if (method == Method::scaled) {
+		if (p >= end || *p < 0 || *p > maxScale) return false;
+		double power = powersOfTen[static_cast<int>(*p++)];
+		uint64_t base;
+		if (!readVarint(p, end, base) || p >= end) return false;
+		unsigned int width = static_cast<uint8_t>(*p++);
+		if (width > maxPackedBits || static_cast<size_t>(end - p) < packedBytes(count, width)) return false;
+		int64_t smallest = unzigzag(base);
+		uint64_t mask = (1ull << width) - 1;
+		for (size_t i = 0; i < count; i++) { // the same division findScale checked, so every value comes back bit for bit
+			int64_t integer = smallest + static_cast<int64_t>(unpack(p, end, i, width, mask));
+			values[i * stride] = static_cast<double>(integer) / power;
+		}
+		p += packedBytes(count, width);
+		return true;
+	}
+	if (method == Method::xorBytes) {
+		uint64_t previous = 0;
+		for (size_t i = 0; i < count; i += 2) {
+			if (p >= end) return false;
+			uint8_t lengths = static_cast<uint8_t>(*p++);
+			unsigned int firstBytes = lengths & 0x0f;
+			unsigned int secondBytes = lengths >> 4;
+			if (firstBytes > 8 || secondBytes > 8 || static_cast<size_t>(end - p) < firstBytes + secondBytes) return false;
+			for (size_t k = 0; k < 2 && i + k < count; k++) {
+				unsigned int bytes = k == 0 ? firstBytes : secondBytes;
+				uint64_t bits = 0;
+				for (unsigned int b = 0; b < bytes; b++) bits |= static_cast<uint64_t>(static_cast<uint8_t>(p[b])) << (8 * b);
+				p += bytes;
+				previous ^= bits;
+				values[(i + k) * stride] = fromBits(previous);
+			}
+		}
+		return true;
+	}
+	return false;
+}
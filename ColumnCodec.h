@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Lossless encodings of the columns of a block file. A column of doubles is stored in the smallest of three forms:
+	scaled when every value is a decimal with few digits, as the prices and amounts of the datasets are: the values times a
+	power of ten are integers, stored as their distance from the smallest of them in as few bits as the largest distance needs.
+	xorBytes for other values: each value is xor'ed with the one before it and only the bytes below its leading zero bytes are kept.
+	raw as the last resort. Bit packed values sit at fixed positions, so they are decoded without waiting on the ones before them.
+	Integer columns that only grow, such as timestamps and offsets, are stored as varint deltas */
+class ColumnCodec {
+	public:
+		enum class Method : uint8_t { raw, scaled, xorBytes };
+
+		/** appends count doubles, read stride doubles apart starting at values, to out */
+		static void encode(const double* values, size_t count, size_t stride, std::vector<char>& out);
+		/** decodes a column written by encode into count doubles stride doubles apart. Returns false if the column runs past end */
+		static bool decode(const char*& p, const char* end, double* values, size_t count, size_t stride);
+
+		/** appends count indexes that are all below limit, in as few bits as limit - 1 needs */
+		static void encodeIndexes(const uint32_t* values, size_t count, uint32_t limit, std::vector<char>& out);
+		/** decodes count indexes written by encodeIndexes with the same limit. Returns false if they run past end */
+		static bool decodeIndexes(const char*& p, const char* end, uint32_t* values, size_t count, uint32_t limit);
+
+		/** appends the values as varint deltas of the value before them */
+		template <typename Integer>
+		static void encodeDeltas(const std::vector<Integer>& values, std::vector<char>& out) {
+			uint64_t previous = 0;
+			for (Integer value : values) {
+				appendVarint(out, zigzag(static_cast<int64_t>(static_cast<uint64_t>(value) - previous)));
+				previous = static_cast<uint64_t>(value);
+			}
+		}
+		/** decodes count values written by encodeDeltas. Returns false if they run past end */
+		template <typename Integer>
+		static bool decodeDeltas(const char*& p, const char* end, size_t count, std::vector<Integer>& values) {
+			values.resize(count);
+			uint64_t value = 0;
+			for (size_t i = 0; i < count; i++) {
+				uint64_t delta;
+				if (!readVarint(p, end, delta)) return false;
+				value += static_cast<uint64_t>(unzigzag(delta));
+				values[i] = static_cast<Integer>(value);
+			}
+			return true;
+		}
+
+		static void appendVarint(std::vector<char>& out, uint64_t value);
+		static bool readVarint(const char*& p, const char* end, uint64_t& value);
+
+	private:
+		/** the smallest power of ten that turns every value into an integer that converts back to it exactly, -1 if there is none */
+		static int findScale(const double* values, size_t count, size_t stride);
+		static void encodeScaled(const double* values, size_t count, size_t stride, int scale, std::vector<char>& out);
+		static void encodeXor(const double* values, size_t count, size_t stride, std::vector<char>& out);
+
+		static uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+		static int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+		/** powers of ten up to 10^maxScale are exact doubles */
+		static const int maxScale = 15;
+};
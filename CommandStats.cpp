@@ -0,0 +1,128 @@
+#include "CommandStats.h"
+#include <algorithm>
+#include <iomanip>
+
+LatencyHistogram::LatencyHistogram() : maximum(0) {
+	for (std::atomic<uint64_t>& bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t nanoseconds) {
+	if (nanoseconds < subBuckets) {
+		return static_cast<size_t>(nanoseconds);
+	}
+	unsigned int power = 0; // index of the highest set bit
+	for (unsigned int shift = 32; shift > 0; shift /= 2) {
+		if (nanoseconds >> (power + shift)) power += shift;
+	}
+	size_t sub = static_cast<size_t>(nanoseconds >> (power - 4)) & (subBuckets - 1);
+	return (power - 3) * subBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketLimit(size_t bucket) {
+	if (bucket < subBuckets) {
+		return bucket;
+	}
+	unsigned int power = static_cast<unsigned int>(bucket / subBuckets) + 3;
+	uint64_t sub = bucket % subBuckets;
+	uint64_t width = uint64_t{1} << (power - 4);
+	return ((subBuckets + sub) << (power - 4)) + (width - 1);
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+	buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	uint64_t seen = maximum.load(std::memory_order_relaxed);
+	while (nanoseconds > seen && !maximum.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {
+	}
+}
+
+uint64_t LatencyHistogram::getCount() const { // summed when asked for, so recording costs one atomic add
+	uint64_t count = 0;
+	for (const std::atomic<uint64_t>& bucket : buckets) {
+		count += bucket.load(std::memory_order_relaxed);
+	}
+	return count;
+}
+
+uint64_t LatencyHistogram::getMax() const {
+	return maximum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getPercentile(double fraction) const {
+	uint64_t total = getCount();
+	if (total == 0) {
+		return 0;
+	}
+	uint64_t rank = static_cast<uint64_t>(fraction * total + 0.999999); // the latency at least this many recorded ones are not above
+	rank = std::min(std::max<uint64_t>(rank, 1), total);
+	uint64_t seen = 0;
+	for (size_t b = 0; b < bucketCount; b++) {
+		seen += buckets[b].load(std::memory_order_relaxed);
+		if (seen >= rank) {
+			return std::min(bucketLimit(b), getMax());
+		}
+	}
+	return getMax(); // buckets recorded into while summing
+}
+
+CommandStats::CommandStats() {
+
+}
+
+const char* CommandStats::commandName(Command command) {
+	switch (command) {
+		case Command::help: return "help";
+		case Command::prod: return "prod";
+		case Command::minimum: return "min";
+		case Command::maximum: return "max";
+		case Command::average: return "avg";
+		case Command::predict: return "predict";
+		case Command::time: return "time";
+		case Command::step: return "step";
+		case Command::liquidity: return "liquidity";
+		case Command::stats: return "stats";
+		case Command::bid: return "bid";
+		case Command::ask: return "ask";
+		case Command::orders: return "orders";
+		case Command::cancel: return "cancel";
+		case Command::sales: return "sales";
+		case Command::depth: return "depth";
+		case Command::fill: return "fill";
+		case Command::imbalance: return "imbalance";
+		case Command::jump: return "goto";
+		case Command::summary: return "summary";
+		default: return "invalid";
+	}
+}
+
+void CommandStats::record(Command command, uint64_t nanoseconds, const QueryCounters& work) {
+	CommandEntry& entry = commands[static_cast<size_t>(command)];
+	entry.latency.record(nanoseconds);
+	if (work.rowsScanned > 0) entry.rowsScanned.fetch_add(work.rowsScanned, std::memory_order_relaxed);
+	if (work.rowsCopied > 0) entry.rowsCopied.fetch_add(work.rowsCopied, std::memory_order_relaxed);
+	if (work.timestepsTraversed > 0) entry.timestepsTraversed.fetch_add(work.timestepsTraversed, std::memory_order_relaxed);
+}
+
+void CommandStats::print(std::ostream& output) const {
+	std::ios::fmtflags flags = output.flags();
+	std::streamsize precision = output.precision();
+	output << std::fixed << std::setprecision(1);
+	bool any = false;
+	for (size_t c = 0; c < commandCount; c++) {
+		const CommandEntry& entry = commands[c];
+		uint64_t runs = entry.latency.getCount();
+		if (runs == 0) continue;
+		any = true;
+		output << commandName(static_cast<Command>(c)) << ": " << runs << " runs, latency p50 " << entry.latency.getPercentile(0.5) / 1000.0
+			   << " us, p90 " << entry.latency.getPercentile(0.9) / 1000.0 << " us, p99 " << entry.latency.getPercentile(0.99) / 1000.0
+			   << " us, max " << entry.latency.getMax() / 1000.0 << " us, per run " << entry.rowsScanned.load(std::memory_order_relaxed) / static_cast<double>(runs)
+			   << " rows scanned, " << entry.rowsCopied.load(std::memory_order_relaxed) / static_cast<double>(runs) << " rows copied, "
+			   << entry.timestepsTraversed.load(std::memory_order_relaxed) / static_cast<double>(runs) << " timesteps traversed" << "\n";
+	}
+	if (!any) {
+		output << "No commands were run yet" << "\n";
+	}
+	output.flags(flags);
+	output.precision(precision);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "OrderBook.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/** Histogram of latencies in nanoseconds, with 16 buckets per power of two so a percentile is within about 6% of the true value.
+	Recording is one relaxed atomic add, so many threads can record into one histogram without locking */
+class LatencyHistogram {
+	public:
+		LatencyHistogram();
+		void record(uint64_t nanoseconds);
+		uint64_t getCount() const;
+		/** upper bound of the bucket holding the sent fraction (0 to 1) of the recorded latencies, 0 if none were recorded */
+		uint64_t getPercentile(double fraction) const;
+		/** the largest latency recorded, exactly */
+		uint64_t getMax() const;
+
+	private:
+		static const unsigned int subBuckets = 16;
+		/** values below 16 get a bucket each, then 16 buckets for each power of two up to 2^63 */
+		static const size_t bucketCount = subBuckets * 61;
+		static size_t bucketOf(uint64_t nanoseconds);
+		/** the largest value that falls in the bucket */
+		static uint64_t bucketLimit(size_t bucket);
+
+		std::array<std::atomic<uint64_t>, bucketCount> buckets;
+		std::atomic<uint64_t> maximum;
+};
+
+/** Latency and work of every command AdvisorMain runs, by command. One CommandStats can be shared by many sessions and threads */
+class CommandStats {
+	public:
+		/** the commands that are counted apart, invalid counts every line that is not a command */
+		enum class Command {help, prod, minimum, maximum, average, predict, time, step, liquidity, stats, bid, ask, orders, cancel, sales, depth, fill, imbalance, jump, summary, invalid};
+		static const size_t commandCount = static_cast<size_t>(Command::invalid) + 1;
+
+		CommandStats();
+		/** adds one run of the command that took nanoseconds and did the work counted in work */
+		void record(Command command, uint64_t nanoseconds, const QueryCounters& work);
+		/** one line per command that was run: runs, p50, p90, p99 and max latency and the work per run */
+		void print(std::ostream& output) const;
+
+	private:
+		struct CommandEntry {
+			LatencyHistogram latency;
+			std::atomic<uint64_t> rowsScanned{0};
+			std::atomic<uint64_t> rowsCopied{0};
+			std::atomic<uint64_t> timestepsTraversed{0};
+		};
+		static const char* commandName(Command command);
+
+		std::array<CommandEntry, commandCount> commands;
+};
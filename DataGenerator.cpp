@@ -0,0 +1,120 @@
+#include "DataGenerator.h"
+#include "Timestamp.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+	/** the products of the exchange dataset and a price each of them traded near */
+	struct ProductStart {
+		const char* name;
+		double price;
+	};
+	const ProductStart exchangeProducts[] = {
+		{"BTC/USDT", 9300.0},
+		{"DOGE/BTC", 3.1e-7},
+		{"DOGE/USDT", 0.0028},
+		{"ETH/BTC", 0.0248},
+		{"ETH/USDT", 230.0}
+	};
+	const size_t exchangeProductCount = sizeof(exchangeProducts) / sizeof(exchangeProducts[0]);
+
+	/** days from 1970/01/01 to 2020/06/01 */
+	const int64_t firstDay = 18414;
+	const uint64_t secondsPerTimestep = 3;
+}
+
+uint64_t DataGenerator::Random::next() {
+	uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+double DataGenerator::Random::uniform() {
+	return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); // 53 random bits
+}
+
+double DataGenerator::Random::normal() {
+	double sum = 0;
+	for (int i = 0; i < 12; i++) {
+		sum += uniform();
+	}
+	return sum - 6.0;
+}
+
+std::vector<std::string> DataGenerator::productNames(size_t products) {
+	std::vector<std::string> names;
+	for (size_t p = 0; p < products; p++) {
+		if (p < exchangeProductCount) {
+			names.push_back(exchangeProducts[p].name);
+		} else {
+			names.push_back("COIN" + std::to_string(p - exchangeProductCount + 1) + "/USDT");
+		}
+	}
+	return names;
+}
+
+DataGeneratorResult DataGenerator::write(const DataGeneratorOptions& options, std::ostream& output) {
+	DataGeneratorResult result;
+	size_t products = std::max<size_t>(options.products, 1);
+	std::vector<std::string> names = productNames(products);
+	Random random{options.seed};
+
+	std::vector<double> mid(products);
+	for (size_t p = 0; p < products; p++) {
+		mid[p] = p < exchangeProductCount ? exchangeProducts[p].price : 1.0 + static_cast<double>(p % 100);
+	}
+	size_t perSide = std::max<size_t>(options.ordersPerTimestep / (2 * products), 1);
+
+	std::string buffer;
+	buffer.reserve(1 << 20);
+	char timestamp[32];
+	char line[128];
+	for (size_t t = 0; options.fileSize > 0 ? result.bytes < options.fileSize : t < options.timesteps; t++) {
+		size_t before = buffer.size();
+		int64_t seconds = firstDay * 86400 + static_cast<int64_t>(t * secondsPerTimestep);
+		Timestamp::format(seconds * Timestamp::microsecondsPerSecond + static_cast<int64_t>(random.next() % 1000000), timestamp);
+		timestamp[Timestamp::formattedLength] = '\0';
+		for (size_t p = 0; p < products; p++) {
+			mid[p] *= 1.0 + 0.002 * random.normal();
+			for (int side = 0; side < 2; side++) { // asks then bids, as they sort in the exchange dataset
+				size_t count = perSide / 2 + 1 + static_cast<size_t>(random.next() % perSide);
+				for (size_t o = 0; o < count; o++) {
+					double distance = 0.0005 + 0.01 * std::fabs(random.normal());
+					double price = side == 0 ? mid[p] * (1.0 + distance) : mid[p] * (1.0 - distance);
+					double amount = 20.0 * random.uniform();
+					int length = std::snprintf(line, sizeof(line), "%s,%s,%s,%.8g,%.8f\n",
+											   timestamp, names[p].c_str(), side == 0 ? "ask" : "bid", price, amount);
+					buffer.append(line, static_cast<size_t>(length));
+					result.rows++;
+				}
+			}
+		}
+		result.timesteps++;
+		result.bytes += buffer.size() - before;
+		if (buffer.size() >= (1 << 20) - (1 << 16)) {
+			output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			buffer.clear();
+		}
+	}
+	output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	return result;
+}
+
+bool DataGenerator::writeFile(const DataGeneratorOptions& options, const std::string& filename, DataGeneratorResult& result) {
+	std::ofstream file{filename, std::ios::binary};
+	if (!file.is_open()) {
+		std::cerr << "Could not open " << filename << std::endl;
+		return false;
+	}
+	result = write(options, file);
+	file.close();
+	if (!file) {
+		std::cerr << "Could not write " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
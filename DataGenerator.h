@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** Settings of a generated dataset */
+struct DataGeneratorOptions {
+	/** number of products. The first five are the products of the exchange dataset, the others are named COIN<n>/USDT */
+	size_t products = 5;
+	/** number of timesteps, 3 seconds apart from 2020/06/01 00:00:00 */
+	size_t timesteps = 1000;
+	/** bids and asks per timestep over all products, on average. Every product and side gets at least one */
+	size_t ordersPerTimestep = 200;
+	/** when not 0, timesteps are written until the file holds at least this many bytes, instead of writing timesteps of them */
+	size_t fileSize = 0;
+	/** the same seed and settings give the same file, byte for byte */
+	uint64_t seed = 1;
+};
+
+/** What DataGenerator wrote */
+struct DataGeneratorResult {
+	size_t timesteps = 0;
+	size_t rows = 0;
+	size_t bytes = 0;
+};
+
+/** Writes synthetic order books in the timestamp,product,type,price,amount csv format of the exchange dataset.
+	Prices follow a random walk per product, with bids below and asks above it. Only integer arithmetic and
+	basic double operations are used, so the output does not depend on the compiler or its standard library */
+class DataGenerator {
+	public:
+		/** writes the dataset described by options to output */
+		static DataGeneratorResult write(const DataGeneratorOptions& options, std::ostream& output);
+		/** writes the dataset to a file, returns false and prints why if it could not be written */
+		static bool writeFile(const DataGeneratorOptions& options, const std::string& filename, DataGeneratorResult& result);
+		/** names of the products of a dataset with the sent number of products, in the order they are written */
+		static std::vector<std::string> productNames(size_t products);
+
+	private:
+		/** splitmix64, small and the same everywhere unlike the std distributions */
+		struct Random {
+			uint64_t state;
+			uint64_t next();
+			/** uniform in [0, 1) */
+			double uniform();
+			/** approximately normal with mean 0 and deviation 1, from the sum of 12 uniforms */
+			double normal();
+		};
+};
@@ -0,0 +1,221 @@
+#include "DatasetCatalog.h"
+#include <algorithm>
+#include <filesystem>
+
+DatasetCatalog::DatasetCatalog(std::vector<std::string> _files, OrderBookOptions _options, size_t _memoryBudget)
+	: options(_options), memoryBudget(_memoryBudget), useClock(0), loadCount(0) {
+	for (const std::string& file : _files) {
+		Day day;
+		day.file = file;
+		days.push_back(day);
+	}
+}
+
+std::vector<std::string> DatasetCatalog::scanDirectory(const std::string& directory) {
+	std::vector<std::string> files;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator{directory, error}) {
+		if (entry.is_regular_file() && entry.path().extension() == ".csv") {
+			files.push_back(entry.path().string());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+size_t DatasetCatalog::getDayCount() const {
+	return days.size();
+}
+
+const std::string& DatasetCatalog::getDayFile(size_t day) const {
+	return days[day].file;
+}
+
+std::shared_ptr<const OrderBook> DatasetCatalog::getDay(size_t day) {
+	std::unique_lock<std::mutex> lock{mutex};
+	return useDay(lock, day);
+}
+
+std::shared_ptr<OrderBook> DatasetCatalog::getLiveDay() {
+	if (!options.follow || days.empty()) {
+		return nullptr;
+	}
+	std::unique_lock<std::mutex> lock{mutex};
+	return useDay(lock, days.size() - 1);
+}
+
+std::pmr::vector<DaySegment> DatasetCatalog::getWindow(size_t day, size_t step, size_t count, std::pmr::memory_resource* resource) {
+	std::pmr::vector<DaySegment> window{resource};
+	std::unique_lock<std::mutex> lock{mutex};
+	// the timesteps are counted first, a day is at most loaded once here to learn its count and may be dropped again
+	size_t available = 0;
+	for (size_t d = day; available < count; d--) {
+		size_t steps = dayTimesteps(lock, d);
+		available += d == day ? std::min(steps, step + 1) : steps;
+		if (d == 0) break;
+	}
+	if (available < count) {
+		return window;
+	}
+	size_t lastStep = step;
+	while (count > 0) {
+		std::shared_ptr<OrderBook> book = useDay(lock, day);
+		size_t steps = book->getTimestepCount();
+		if (steps > 0) {
+			lastStep = std::min(lastStep, steps - 1);
+			size_t taken = std::min(count, lastStep + 1);
+			window.push_back(DaySegment{book, day, lastStep + 1 - taken, lastStep});
+			count -= taken;
+		}
+		if (day == 0) break;
+		day--;
+		lastStep = static_cast<size_t>(-1); // earlier days are taken from their last timestep
+	}
+	std::reverse(window.begin(), window.end());
+	return window;
+}
+
+std::pmr::vector<DaySegment> DatasetCatalog::getTimeRange(int64_t from, int64_t to, std::pmr::memory_resource* resource) {
+	std::pmr::vector<DaySegment> range{resource};
+	std::unique_lock<std::mutex> lock{mutex};
+	for (size_t day = findDay(lock, from); day < days.size() && from <= to; day++) {
+		if (dayTimes(lock, day).firstTime > to) break; // the day starts after the range, so the days after it do too
+		std::shared_ptr<OrderBook> book = useDay(lock, day);
+		size_t firstStep = book->getTimestepAtOrAfter(from);
+		size_t end = book->getTimestepAfter(to);
+		if (firstStep < end) {
+			range.push_back(DaySegment{book, day, firstStep, end - 1});
+		}
+		if (end < book->getTimestepCount()) break; // the day goes on past the range, so the days after it do too
+	}
+	return range;
+}
+
+bool DatasetCatalog::findTime(int64_t time, size_t& day, size_t& step) {
+	std::unique_lock<std::mutex> lock{mutex};
+	for (size_t d = findDay(lock, time); d < days.size(); d++) {
+		std::shared_ptr<OrderBook> book = useDay(lock, d);
+		size_t found = book->getTimestepAtOrAfter(time);
+		if (found < book->getTimestepCount()) {
+			day = d;
+			step = found;
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t DatasetCatalog::getLoadedBytes() {
+	std::lock_guard<std::mutex> lock{mutex};
+	size_t bytes = 0;
+	for (const Day& day : days) {
+		if (day.book) bytes += day.bytes;
+	}
+	return bytes;
+}
+
+size_t DatasetCatalog::getLoadedDays() {
+	std::lock_guard<std::mutex> lock{mutex};
+	size_t loaded = 0;
+	for (const Day& day : days) {
+		if (day.book) loaded++;
+	}
+	return loaded;
+}
+
+size_t DatasetCatalog::getLoadCount() {
+	std::lock_guard<std::mutex> lock{mutex};
+	return loadCount;
+}
+
+std::shared_ptr<OrderBook> DatasetCatalog::useDay(std::unique_lock<std::mutex>& lock, size_t day) {
+	Day& entry = days[day];
+	entry.lastUse = ++useClock;
+	while (!entry.book) {
+		if (entry.loading) { // the day may be dropped again before this thread wakes, so it is checked again
+			loaded.wait(lock);
+			continue;
+		}
+		entry.loading = true;
+		OrderBookOptions dayOptions = options;
+		dayOptions.follow = options.follow && day + 1 == days.size();
+		std::shared_ptr<OrderBook> book;
+		lock.unlock(); // the other days stay usable while this one is read
+		try {
+			book = std::make_shared<OrderBook>(entry.file, dayOptions);
+		} catch (...) {
+			lock.lock();
+			entry.loading = false;
+			loaded.notify_all();
+			throw;
+		}
+		lock.lock();
+		entry.loading = false;
+		entry.book = book;
+		entry.bytes = book->memoryUsage();
+		size_t steps = book->getTimestepCount();
+		if (steps > 0) {
+			entry.firstTime = book->getTime(0);
+			entry.lastTime = dayOptions.follow ? INT64_MAX : book->getTime(steps - 1); // a followed day goes on growing
+		}
+		entry.timestepCount = steps;
+		entry.timesKnown = true;
+		loadCount++;
+		loaded.notify_all();
+		evict(day);
+		return book;
+	}
+	return entry.book;
+}
+
+const DatasetCatalog::Day& DatasetCatalog::dayTimes(std::unique_lock<std::mutex>& lock, size_t day) {
+	if (!days[day].timesKnown) {
+		useDay(lock, day);
+	}
+	return days[day];
+}
+
+size_t DatasetCatalog::dayTimesteps(std::unique_lock<std::mutex>& lock, size_t day) {
+	if (days[day].book) {
+		return days[day].book->getTimestepCount();
+	}
+	return dayTimes(lock, day).timestepCount;
+}
+
+size_t DatasetCatalog::findDay(std::unique_lock<std::mutex>& lock, int64_t time) {
+	size_t low = 0;
+	size_t high = days.size();
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (dayTimes(lock, middle).lastTime < time) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+void DatasetCatalog::evict(size_t keep) {
+	if (memoryBudget == 0) {
+		return;
+	}
+	size_t bytes = 0;
+	for (const Day& day : days) {
+		if (day.book) bytes += day.bytes;
+	}
+	while (bytes > memoryBudget) {
+		size_t oldest = days.size();
+		for (size_t d = 0; d < days.size(); d++) {
+			bool pinned = d == keep || (options.follow && d + 1 == days.size()); // a followed day is appended to by its CSVTail
+			if (days[d].book && !pinned && (oldest == days.size() || days[d].lastUse < days[oldest].lastUse)) {
+				oldest = d;
+			}
+		}
+		if (oldest == days.size()) {
+			return; // only the days that cannot be dropped are left
+		}
+		bytes -= days[oldest].bytes;
+		days[oldest].book.reset();
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "OrderBook.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** Timesteps firstStep to lastStep, both included, of one day of a DatasetCatalog */
+struct DaySegment {
+	std::shared_ptr<const OrderBook> book;
+	size_t day;
+	size_t firstStep;
+	size_t lastStep;
+};
+
+/** Daily csv files read as one timeline, day after day. A day is only loaded when something asks for it,
+	and the least recently used days are dropped once the loaded days hold more than the memory budget.
+	A dropped day stays valid for whoever still holds its shared_ptr. Safe to use from many threads */
+class DatasetCatalog {
+	public:
+		/** catalog of the sent csv files, in the sent order. memoryBudget is in bytes, 0 keeps every loaded day.
+			With options.follow only the last day is followed, and it is never dropped */
+		DatasetCatalog(std::vector<std::string> _files, OrderBookOptions _options, size_t _memoryBudget = 0);
+		/** the csv files in the sent directory sorted by name, so files named by date (20200601.csv, ...) are in time order */
+		static std::vector<std::string> scanDirectory(const std::string& directory);
+
+		size_t getDayCount() const;
+		/** file the day is loaded from */
+		const std::string& getDayFile(size_t day) const;
+		/** the orderbook of the day, loading it if it is not loaded. Marks the day as the most recently used */
+		std::shared_ptr<const OrderBook> getDay(size_t day);
+		/** the last day, for a CSVTail to append to. nullptr unless the catalog was made with follow */
+		std::shared_ptr<OrderBook> getLiveDay();
+		/** the count timesteps up to and including (day, step), oldest first, reaching back into earlier days as needed.
+			Empty if the timeline starts before count timesteps, which is found from the step counts kept of each day,
+			so a window that is too long does not hold every earlier day. The vector is allocated from resource */
+		std::pmr::vector<DaySegment> getWindow(size_t day, size_t step, size_t count, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		/** the timesteps from time from to time to, both included, oldest first. The days must be in time order: they are binary searched
+			on the first and last times kept from their first load, and only the days the range overlaps are loaded again */
+		std::pmr::vector<DaySegment> getTimeRange(int64_t from, int64_t to, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		/** finds the first timestep at or after time, returns false if the timeline ends before it */
+		bool findTime(int64_t time, size_t& day, size_t& step);
+
+		/** bytes held by the loaded days, as counted against the budget */
+		size_t getLoadedBytes();
+		size_t getLoadedDays();
+		/** number of times a day was loaded, including loading it again after it was dropped */
+		size_t getLoadCount();
+
+	private:
+		struct Day {
+			std::string file;
+			std::shared_ptr<OrderBook> book;
+			size_t bytes = 0;
+			/** value of useClock when the day was last asked for */
+			uint64_t lastUse = 0;
+			/** times of the first and last timestep, kept from the first load so a dropped day is searched without loading it again.
+				An empty day keeps the widest times so the search never skips past it */
+			int64_t firstTime = INT64_MIN;
+			int64_t lastTime = INT64_MAX;
+			/** timesteps of the day when it was last loaded */
+			size_t timestepCount = 0;
+			/** false until the day was loaded once */
+			bool timesKnown = false;
+			/** a thread is reading the day with mutex released, the others wait on loaded for it */
+			bool loading = false;
+		};
+
+		/** loads the day if needed and marks it used, with mutex held by lock. The mutex is released while the file is read,
+			so one slow load does not hold up the threads using other days */
+		std::shared_ptr<OrderBook> useDay(std::unique_lock<std::mutex>& lock, size_t day);
+		/** the day with firstTime, lastTime and timestepCount known, with mutex held by lock */
+		const Day& dayTimes(std::unique_lock<std::mutex>& lock, size_t day);
+		/** timesteps of the day, read from the book while it is loaded as a followed day grows, with mutex held by lock */
+		size_t dayTimesteps(std::unique_lock<std::mutex>& lock, size_t day);
+		/** binary search for the first day whose last timestep may be at or after time, days.size() if there is none, with mutex held by lock */
+		size_t findDay(std::unique_lock<std::mutex>& lock, int64_t time);
+		/** drops least recently used days, but not keep, until the loaded days fit the budget */
+		void evict(size_t keep);
+
+		std::vector<Day> days;
+		OrderBookOptions options;
+		size_t memoryBudget;
+		uint64_t useClock;
+		size_t loadCount;
+		std::mutex mutex;
+		/** signalled when a day finished loading */
+		std::condition_variable loaded;
+};
@@ -0,0 +1,44 @@
+#include "DepthLadder.h"
+#include <algorithm>
+#include <cmath>
+
+void DepthLadder::sortOrder(const double* prices, size_t count, bool bids, std::vector<uint32_t>& order) {
+	// a nan price is neither better nor worse than any other, so it would break the ordering std::sort needs.
+	// Those rows go last, in row order, and only the rows with a price are sorted
+	order.clear();
+	for (uint32_t row = 0; row < count; row++) {
+		if (!std::isnan(prices[row])) order.push_back(row);
+	}
+	size_t priced = order.size();
+	for (uint32_t row = 0; row < count; row++) {
+		if (std::isnan(prices[row])) order.push_back(row);
+	}
+	// orders at one price keep their row order, so the levels are summed in the same order on every run and on both sides.
+	// Comparing the indexes gives what std::stable_sort would without its buffer
+	if (bids) {
+		std::sort(order.begin(), order.begin() + priced, [prices](uint32_t a, uint32_t b) {
+			return prices[a] > prices[b] || (prices[a] == prices[b] && a < b);
+		});
+	} else {
+		std::sort(order.begin(), order.begin() + priced, [prices](uint32_t a, uint32_t b) {
+			return prices[a] < prices[b] || (prices[a] == prices[b] && a < b);
+		});
+	}
+}
+
+size_t DepthLadder::build(const double* prices, const double* amounts, const uint32_t* order, size_t count, std::vector<DepthLevel>& levels) {
+	size_t firstLevel = levels.size();
+	double amount = 0, notional = 0;
+	for (size_t i = 0; i < count; i++) {
+		double price = prices[order[i]];
+		amount += amounts[order[i]];
+		notional += price * amounts[order[i]];
+		if (levels.size() > firstLevel && levels.back().price == price) {
+			levels.back().cumulativeAmount = amount;
+			levels.back().cumulativeNotional = notional;
+		} else {
+			levels.push_back(DepthLevel{price, amount, notional});
+		}
+	}
+	return levels.size() - firstLevel;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** The orders of a group at one price, with the amounts and price * amount of this and every better level */
+struct DepthLevel {
+	double price;
+	double cumulativeAmount;
+	double cumulativeNotional;
+};
+
+/** Builds the depth ladder of a group from its rows. The rows are put in ladder order first and then summed in that order,
+	so an OrderBook in memory and one decoding its ladders from a block file get bit-identical levels from the same order */
+class DepthLadder {
+	public:
+		/** the indexes of count rows in the order they join the ladder: best first, bids by falling price, asks by rising price.
+			Rows at the same price stay in the order they are in the group, rows with a nan price come last */
+		static void sortOrder(const double* prices, size_t count, bool bids, std::vector<uint32_t>& order);
+		/** appends the levels of count rows taken in order to levels, orders at the same price make one level. Returns the number of levels added */
+		static size_t build(const double* prices, const double* amounts, const uint32_t* order, size_t count, std::vector<DepthLevel>& levels);
+};
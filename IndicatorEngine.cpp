@@ -0,0 +1,90 @@
+#include "IndicatorEngine.h"
+
+IndicatorEngine::IndicatorEngine(const OrderBook& _orderBook) : orderBook(_orderBook), indexVersion(_orderBook.getIndexVersion()) {
+
+}
+
+uint64_t IndicatorEngine::seriesKey(size_t product, OrderBookType type, PriceStat stat) {
+	return (static_cast<uint64_t>(product) << 8) | (static_cast<uint64_t>(type) << 1) | static_cast<uint64_t>(stat);
+}
+
+IndicatorEngine::PriceSeries& IndicatorEngine::getSeries(size_t product, OrderBookType type, PriceStat stat, size_t timestep) {
+	if (indexVersion != orderBook.getIndexVersion()) { // a followed book added a product, which moved the product indexes
+		clear();
+		indexVersion = orderBook.getIndexVersion();
+	}
+	PriceSeries& prices = series[seriesKey(product, type, stat)];
+	while (prices.prices.size() <= timestep) { // only the timesteps not seen before are read from the book
+		double price = priceOf(orderBook.getStats(type, product, prices.prices.size()), stat);
+		prices.prices.push_back(price);
+		prices.prefix.push_back(prices.prefix.back() + price);
+	}
+	return prices;
+}
+
+double IndicatorEngine::getSMA(size_t product, OrderBookType type, PriceStat stat, unsigned int period, size_t timestep) {
+	PriceSeries& prices = getSeries(product, type, stat, timestep);
+	return (prices.prefix[timestep + 1] - prices.prefix[timestep + 1 - period]) / period;
+}
+
+double IndicatorEngine::getEMA(size_t product, OrderBookType type, PriceStat stat, unsigned int period, size_t timestep) {
+	PriceSeries& prices = getSeries(product, type, stat, timestep);
+	EMAState& state = emas[(seriesKey(product, type, stat) << 32) | period];
+
+	if (state.ema.empty()) {
+		state.ema.push_back(prices.prefix[period] / period); // the first average is the plain mean of the first period prices
+	}
+	// carried on from the last timestep already computed
+	for (size_t t = period - 1 + state.ema.size(); t <= timestep; t++) {
+		state.ema.push_back(nextEMA(state.ema.back(), prices.prices[t], period));
+	}
+	return state.ema[timestep - (period - 1)];
+}
+
+void IndicatorEngine::clear() {
+	series.clear();
+	emas.clear();
+}
+
+double IndicatorEngine::getEMA(const std::pmr::vector<DaySegment>& window, std::string_view product, OrderBookType type, PriceStat stat, unsigned int period) {
+	std::pmr::vector<double> prices = windowPrices(window, product, type, stat);
+	double sum = 0;
+	for (size_t t = 0; t < period; t++) {
+		sum += prices[t];
+	}
+	double ema = sum / period; // seeded the same way as the ema of one day
+	for (size_t t = period; t < prices.size(); t++) {
+		ema = nextEMA(ema, prices[t], period);
+	}
+	return ema;
+}
+
+double IndicatorEngine::getSMA(const std::pmr::vector<DaySegment>& window, std::string_view product, OrderBookType type, PriceStat stat, unsigned int period) {
+	std::pmr::vector<double> prices = windowPrices(window, product, type, stat);
+	double sum = 0;
+	for (size_t t = prices.size() - period; t < prices.size(); t++) {
+		sum += prices[t];
+	}
+	return sum / period;
+}
+
+double IndicatorEngine::priceOf(const OrderStats& stats, PriceStat stat) {
+	return stats.count == 0 ? 0 : (stat == PriceStat::low ? stats.min : stats.max);
+}
+
+std::pmr::vector<double> IndicatorEngine::windowPrices(const std::pmr::vector<DaySegment>& window, std::string_view product, OrderBookType type, PriceStat stat) {
+	std::pmr::vector<double> prices{window.get_allocator()};
+	for (const DaySegment& segment : window) {
+		size_t segmentProduct = segment.book->getProductIndex(product); // product indexes differ from day to day
+		for (size_t t = segment.firstStep; t <= segment.lastStep; t++) {
+			bool known = segmentProduct < segment.book->getKnownProducts().size();
+			prices.push_back(known ? priceOf(segment.book->getStats(type, segmentProduct, t), stat) : 0);
+		}
+	}
+	return prices;
+}
+
+double IndicatorEngine::nextEMA(double previous, double price, unsigned int period) {
+	double smoothing = 2.0 / (period + 1.0);
+	return price * smoothing + previous * (1.0 - smoothing);
+}
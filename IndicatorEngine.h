@@ -0,0 +1,63 @@
+#pragma once
+#include "DatasetCatalog.h"
+#include "OrderBook.h"
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/** Which price of a timestep an indicator follows */
+enum class PriceStat {low, high};
+
+/** Moving averages of the lowest or highest bid/ask price of each timestep, for any product, side and period.
+	Values are computed the first time a timestep is asked for and cached, so following the cursor forward
+	costs O(1) per timestep and going back to an earlier timestep is a lookup */
+class IndicatorEngine {
+	public:
+		IndicatorEngine(const OrderBook& orderBook);
+
+		/** exponential moving average with smoothing 2 / (period + 1), seeded with the simple moving average of the first period timesteps.
+			Needs timestep + 1 >= period */
+		double getEMA(size_t product, OrderBookType type, PriceStat stat, unsigned int period, size_t timestep);
+		/** simple moving average of the period timesteps up to and including timestep. Needs timestep + 1 >= period */
+		double getSMA(size_t product, OrderBookType type, PriceStat stat, unsigned int period, size_t timestep);
+		/** drops every cached value */
+		void clear();
+
+		/** getEMA over a window that can span days, such as a period reaching back past midnight: seeded with the simple moving
+			average of the first period timesteps of the window and carried on over the rest of it. Needs at least period timesteps */
+		static double getEMA(const std::pmr::vector<DaySegment>& window, std::string_view product, OrderBookType type, PriceStat stat, unsigned int period);
+		/** simple moving average of the last period timesteps of a window that can span days. Needs at least period timesteps */
+		static double getSMA(const std::pmr::vector<DaySegment>& window, std::string_view product, OrderBookType type, PriceStat stat, unsigned int period);
+
+	private:
+		/** per timestep prices of one product, side and stat. Timesteps without orders count as 0 */
+		struct PriceSeries {
+			std::vector<double> prices;
+			/** prefix[i] is the sum of the first i prices */
+			std::vector<double> prefix{0.0};
+		};
+		/** ema[i] is the average at timestep period - 1 + i */
+		struct EMAState {
+			std::vector<double> ema;
+		};
+
+		/** the price an indicator follows, 0 for a timestep without orders */
+		static double priceOf(const OrderStats& stats, PriceStat stat);
+		/** the prices of every timestep of the window, oldest first */
+		static std::pmr::vector<double> windowPrices(const std::pmr::vector<DaySegment>& window, std::string_view product, OrderBookType type, PriceStat stat);
+		/** EMA = price * smoothing + previous EMA * (1 - smoothing), with smoothing 2 / (period + 1) */
+		static double nextEMA(double previous, double price, unsigned int period);
+
+		/** returns the series of the key, extended up to and including timestep */
+		PriceSeries& getSeries(size_t product, OrderBookType type, PriceStat stat, size_t timestep);
+		static uint64_t seriesKey(size_t product, OrderBookType type, PriceStat stat);
+
+		const OrderBook& orderBook;
+		/** OrderBook::getIndexVersion the caches were built with, the product indexes in their keys are only valid for it */
+		size_t indexVersion;
+		std::unordered_map<uint64_t, PriceSeries> series;
+		/** keyed by seriesKey and period */
+		std::unordered_map<uint64_t, EMAState> emas;
+};
@@ -0,0 +1,161 @@
+#include "LoadGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+bool LoadGenerator::run(const LoadGeneratorOptions& options, LoadGeneratorReport& report) {
+	std::vector<std::string> commands;
+	if (options.commandFile.empty()) {
+		commands = defaultCommands();
+	} else {
+		std::ifstream file{options.commandFile};
+		std::string line;
+		while (std::getline(file, line)) {
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (!line.empty()) commands.push_back(line);
+		}
+		if (commands.empty()) {
+			std::cerr << "No commands in " << options.commandFile << std::endl;
+			return false;
+		}
+	}
+	unsigned int clients = options.clients == 0 ? 1 : options.clients;
+#ifndef _WIN32
+	signal(SIGPIPE, SIG_IGN); // a server closing a connection fails the next send, which counts as a lost request, instead of killing the run
+#endif
+
+	std::vector<std::vector<double>> latencies(clients);
+	std::vector<size_t> answered(clients, 0);
+	std::vector<size_t> rejected(clients, 0);
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int c = 0; c < clients; c++) {
+		size_t requests = options.requests / clients + (c < options.requests % clients ? 1 : 0);
+		size_t firstCommand = c * commands.size() / clients; // clients start at different commands so they do not move in step
+		threads.emplace_back([&, c, requests, firstCommand] {
+			answered[c] = runClient(options.socketPath, commands, firstCommand, requests, latencies[c], rejected[c]);
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	std::vector<double> all;
+	for (const std::vector<double>& client : latencies) {
+		all.insert(all.end(), client.begin(), client.end());
+	}
+	report = LoadGeneratorReport{};
+	for (size_t a : answered) report.requests += a;
+	for (size_t r : rejected) report.rejected += r;
+	report.errors = options.requests - report.requests;
+	report.seconds = std::chrono::duration<double>(end - start).count();
+	if (all.empty()) {
+		return false;
+	}
+	std::sort(all.begin(), all.end());
+	report.queriesPerSecond = report.seconds > 0 ? report.requests / report.seconds : 0;
+	report.p50 = all[(all.size() - 1) * 50 / 100];
+	report.p99 = all[(all.size() - 1) * 99 / 100];
+	report.max = all.back();
+	return true;
+}
+
+void LoadGenerator::printReport(const LoadGeneratorReport& report, std::ostream& output) {
+	output << "requests " << report.requests << ", errors " << report.errors << ", rejected " << report.rejected << ", " << report.seconds << " s" << "\n";
+	output << "qps " << static_cast<size_t>(report.queriesPerSecond) << "\n";
+	output << "latency p50 " << report.p50 << " us, p99 " << report.p99 << " us, max " << report.max << " us" << "\n";
+}
+
+#ifdef _WIN32
+
+size_t LoadGenerator::runClient(const std::string&, const std::vector<std::string>&, size_t, size_t, std::vector<double>&, size_t&) {
+	std::cerr << "The load generator needs Unix domain sockets, it is not available in this build" << std::endl;
+	return 0;
+}
+
+#else
+
+size_t LoadGenerator::runClient(const std::string& socketPath, const std::vector<std::string>& commands, size_t firstCommand, size_t requests, std::vector<double>& latencies, size_t& rejected) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path)) {
+		std::cerr << "Socket path is too long" << std::endl;
+		return 0;
+	}
+	std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0 || connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		std::cerr << "Could not connect to " << socketPath << ": " << std::strerror(errno) << std::endl;
+		if (server >= 0) close(server);
+		return 0;
+	}
+
+	latencies.reserve(requests);
+	std::string request;
+	std::string received;
+	char buffer[16 * 1024];
+	size_t answered = 0;
+	for (size_t r = 0; r < requests; r++) {
+		request = commands[(firstCommand + r) % commands.size()];
+		request += '\n';
+		auto sent = std::chrono::steady_clock::now();
+		if (send(server, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size())) break; // this and the requests after it are lost
+
+		// the server answers every command with exactly one line
+		size_t newline;
+		bool ok = true;
+		while ((newline = received.find('\n')) == std::string::npos) {
+			ssize_t n = recv(server, buffer, sizeof(buffer), 0);
+			if (n <= 0) {
+				ok = false;
+				break;
+			}
+			received.append(buffer, n);
+		}
+		if (!ok) break;
+		if (isRejection(std::string_view{received}.substr(0, newline))) {
+			rejected++;
+		}
+		received.erase(0, newline + 1);
+		latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+		answered++;
+	}
+	close(server);
+	return answered;
+}
+
+#endif
+
+bool LoadGenerator::isRejection(std::string_view answer) {
+	// the messages AdvisorMain answers a command it cannot run with, they come through the tsv and jsonl escaping unchanged
+	return answer.find("Wrong line input") != std::string_view::npos || answer.find("Invalid input") != std::string_view::npos;
+}
+
+std::vector<std::string> LoadGenerator::defaultCommands() {
+	return std::vector<std::string>{
+		"min ETH/BTC ask",
+		"max ETH/BTC bid",
+		"avg ETH/BTC ask 5",
+		"step",
+		"predict max ETH/BTC bid",
+		"min DOGE/BTC bid",
+		"max BTC/USDT ask",
+		"liquidity ETH/BTC",
+		"time",
+		"avg BTC/USDT bid 3",
+		"step",
+		"prod"
+	};
+}
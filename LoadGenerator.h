@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** Settings of a load generator run */
+struct LoadGeneratorOptions {
+	/** socket of the AdvisorServer to load */
+	std::string socketPath;
+	/** concurrent connections, each sends its next command when the answer to the last one arrives */
+	unsigned int clients = 8;
+	/** commands sent over all connections */
+	size_t requests = 100000;
+	/** file of commands to send, one per line, used round robin. Empty sends a built in mix of queries */
+	std::string commandFile;
+};
+
+/** Result of a load generator run, latencies are in microseconds */
+struct LoadGeneratorReport {
+	/** requests answered, including the rejected ones */
+	size_t requests = 0;
+	/** requests lost: not sent, or not answered before the connection closed */
+	size_t errors = 0;
+	/** answers that reject their command as wrong input, the server itself is fine */
+	size_t rejected = 0;
+	double seconds = 0;
+	double queriesPerSecond = 0;
+	double p50 = 0;
+	double p99 = 0;
+	double max = 0;
+};
+
+/** Client for testing an AdvisorServer: opens many connections, replays commands on them and measures the answers */
+class LoadGenerator {
+	public:
+		/** runs the load described by options, returns false if it could not connect */
+		static bool run(const LoadGeneratorOptions& options, LoadGeneratorReport& report);
+		static void printReport(const LoadGeneratorReport& report, std::ostream& output);
+
+	private:
+		/** sends requests commands on one connection, appending the latency of each answer and counting the rejected ones.
+			Returns the number of answers */
+		static size_t runClient(const std::string& socketPath, const std::vector<std::string>& commands, size_t firstCommand, size_t requests, std::vector<double>& latencies, size_t& rejected);
+		/** true if the answer line says its command was wrong input */
+		static bool isRejection(std::string_view answer);
+		/** the command mix sent when no command file is given */
+		static std::vector<std::string> defaultCommands();
+};
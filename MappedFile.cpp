@@ -0,0 +1,140 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : begin(nullptr), length(0), opened(false) {
+#ifdef _WIN32
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::MappedFile(const std::string& filename) : MappedFile() {
+	open(filename);
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : MappedFile() {
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		std::swap(begin, other.begin);
+		std::swap(length, other.length);
+		std::swap(opened, other.opened);
+#ifdef _WIN32
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+}
+
+bool MappedFile::open(const std::string& filename) {
+	return open(filename, 0, SIZE_MAX);
+}
+
+bool MappedFile::open(const std::string& filename, uint64_t offset, size_t size) { // SIZE_MAX maps to the end of the file
+	close();
+	if (offset % granularity != 0) {
+		return false;
+	}
+	bool wholeFile = offset == 0 && size == SIZE_MAX;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+							  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | (wholeFile ? FILE_FLAG_SEQUENTIAL_SCAN : 0), nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) < offset
+		|| (size != SIZE_MAX && static_cast<uint64_t>(fileSize.QuadPart) - offset < size)) {
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	length = size == SIZE_MAX ? static_cast<size_t>(fileSize.QuadPart - offset) : size;
+	if (length > 0) { // empty files cannot be mapped, they are left open with no data
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			CloseHandle(file);
+			fileHandle = nullptr;
+			length = 0;
+			return false;
+		}
+		mappingHandle = mapping;
+		begin = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), length));
+		if (begin == nullptr) {
+			close();
+			return false;
+		}
+	}
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < offset
+		|| (size != SIZE_MAX && static_cast<uint64_t>(st.st_size) - offset < size)) {
+		::close(fd);
+		return false;
+	}
+	length = size == SIZE_MAX ? static_cast<size_t>(st.st_size - offset) : size;
+	if (length > 0) { // empty files cannot be mapped, they are left open with no data
+		void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+		if (mapped == MAP_FAILED) {
+			::close(fd);
+			length = 0;
+			return false;
+		}
+		if (wholeFile) madvise(mapped, length, MADV_SEQUENTIAL);
+		begin = static_cast<const char*>(mapped);
+	}
+	::close(fd); // the mapping keeps the file alive
+#endif
+	opened = true;
+	return true;
+}
+
+void MappedFile::willNeed() const {
+	if (begin == nullptr) {
+		return;
+	}
+#ifdef _WIN32
+	WIN32_MEMORY_RANGE_ENTRY range{const_cast<char*>(begin), length};
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	madvise(const_cast<char*>(begin), length, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (begin != nullptr) UnmapViewOfFile(begin);
+	if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+	if (fileHandle != nullptr) CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (begin != nullptr) munmap(const_cast<char*>(begin), length);
+#endif
+	begin = nullptr;
+	length = 0;
+	opened = false;
+}
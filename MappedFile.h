@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/** Read-only memory mapping of a whole file or of a range of it. The mapping is released when the object is destroyed */
+class MappedFile {
+	public:
+		/** offsets of mapped ranges must be multiples of this, which covers the page size and the Windows allocation granularity */
+		static const uint64_t granularity = 64 * 1024;
+
+		MappedFile();
+		/** construct, mapping the sent file. Check isOpen() for success */
+		explicit MappedFile(const std::string& filename);
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		/** maps the sent file, releasing any previous mapping. Returns false if the file cannot be opened or mapped */
+		bool open(const std::string& filename);
+		/** maps size bytes of the sent file from offset, a multiple of granularity, releasing any previous mapping.
+			Returns false if the file cannot be opened or mapped or is shorter than the range */
+		bool open(const std::string& filename, uint64_t offset, size_t size);
+		/** asks the system to start reading the mapped pages in, so a later read does not wait for the disk. Returns at once */
+		void willNeed() const;
+		/** releases the mapping */
+		void close();
+
+		bool isOpen() const { return opened; }
+		const char* data() const { return begin; }
+		size_t size() const { return length; }
+		std::string_view view() const { return std::string_view{begin, length}; }
+
+	private:
+		const char* begin;
+		size_t length;
+		bool opened;
+#ifdef _WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#endif
+};
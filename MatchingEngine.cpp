@@ -0,0 +1,160 @@
+#include "MatchingEngine.h"
+#include <algorithm>
+
+MatchingEngine::MatchingEngine() : liveOrders(0), currentBook(nullptr), currentStep(0), currentIndexVersion(0) {
+
+}
+
+void MatchingEngine::matchTimestep(const OrderBook& book, size_t timestep) { // the ladders and pool keep their capacity, so after the first timesteps this does not allocate
+	currentBook = &book;
+	currentStep = timestep;
+	currentIndexVersion = book.getIndexVersion();
+	products.resize(book.getKnownProducts().size());
+	for (ProductBook& productBook : products) {
+		productBook.bids.levels.clear();
+		productBook.asks.levels.clear();
+	}
+	pool.clear();
+	sales.clear();
+
+	for (size_t id = 0; id < userOrders.size(); id++) { // user orders were submitted before the timestep, so they keep the front of their levels
+		const UserOrder& order = userOrders[id];
+		if (order.amount <= 0 || order.cancelled) continue;
+		size_t product = book.getProductIndex(order.product);
+		if (product == products.size()) continue; // the product does not trade in this day
+		addOrder(product, order.orderType, order.price, order.amount, static_cast<uint32_t>(id));
+	}
+
+	for (size_t product = 0; product < products.size(); product++) {
+		for (OrderBookType orderType : {OrderBookType::ask, OrderBookType::bid}) { // asks rest first, so the sales of the dataset are at the ask price
+			OrderRange orders = book.getOrderRange(orderType, product, timestep);
+			const double* prices = orders.prices();
+			const double* amounts = orders.amounts();
+			for (size_t i = 0; i < orders.size(); i++) {
+				if (!(amounts[i] > 0)) continue;
+				addOrder(product, orderType, prices[i], amounts[i], none);
+			}
+		}
+	}
+}
+
+bool MatchingEngine::isAt(const OrderBook& book, size_t timestep) const {
+	// a followed book that added a product moved the product indexes the ladders and sales are kept by
+	return currentBook == &book && currentStep == timestep && currentIndexVersion == book.getIndexVersion();
+}
+
+size_t MatchingEngine::submit(std::string_view username, std::string_view product, OrderBookType orderType, double price, double amount) {
+	if (currentBook == nullptr || !(price > 0) || !(amount > 0) || (orderType != OrderBookType::bid && orderType != OrderBookType::ask)) {
+		return noOrder;
+	}
+	size_t productIndex = currentBook->getProductIndex(product);
+	if (productIndex >= products.size()) {
+		return noOrder;
+	}
+	UserOrder order;
+	order.username = std::string{username};
+	order.product = std::string{product};
+	order.orderType = orderType;
+	order.price = price;
+	order.amount = amount;
+	userOrders.push_back(order);
+	liveOrders++;
+	size_t id = userOrders.size() - 1;
+	addOrder(productIndex, orderType, price, amount, static_cast<uint32_t>(id));
+	return id;
+}
+
+bool MatchingEngine::cancel(size_t id) { // the order stays in its level until matching reaches it, then it is dropped without trading
+	if (id >= userOrders.size() || userOrders[id].amount <= 0 || userOrders[id].cancelled) {
+		return false;
+	}
+	userOrders[id].cancelled = true;
+	userOrders[id].amount = 0;
+	liveOrders--;
+	return true;
+}
+
+void MatchingEngine::addOrder(size_t product, OrderBookType orderType, double price, double amount, uint32_t userOrder) {
+	bool bid = orderType == OrderBookType::bid;
+	Ladder& other = bid ? products[product].asks : products[product].bids;
+	while (amount > 0 && !other.levels.empty()) {
+		Level& best = other.levels.back();
+		if (bid ? price < best.price : price > best.price) break; // the book does not cross any more
+
+		RestingOrder& resting = pool[best.head];
+		bool cancelled = resting.userOrder != none && userOrders[resting.userOrder].cancelled;
+		if (!cancelled) {
+			double fill = std::min(amount, resting.amount);
+			amount -= fill;
+			resting.amount -= fill;
+			if (userOrder != none) {
+				userOrders[userOrder].amount = amount;
+				userOrders[userOrder].filled += fill;
+			}
+			if (resting.userOrder != none) {
+				UserOrder& owner = userOrders[resting.userOrder];
+				owner.amount = resting.amount;
+				owner.filled += fill;
+				if (resting.amount <= 0) liveOrders--;
+			}
+			recordSale(product, best.price, fill, bid ? userOrder : resting.userOrder, bid ? resting.userOrder : userOrder);
+		}
+		if (cancelled || resting.amount <= 0) { // the front order is done, the level goes with its last order
+			best.head = resting.next;
+			if (best.head == none) other.levels.pop_back();
+		}
+	}
+	if (userOrder != none && amount <= 0) {
+		liveOrders--;
+	}
+	if (amount > 0) {
+		rest(bid ? products[product].bids : products[product].asks, bid, price, amount, userOrder);
+	}
+}
+
+void MatchingEngine::rest(Ladder& ladder, bool bidSide, double price, double amount, uint32_t userOrder) {
+	uint32_t index = static_cast<uint32_t>(pool.size());
+	pool.push_back(RestingOrder{amount, none, userOrder});
+
+	// bids rise and asks fall towards the back, find the first level that is not worse than the price
+	auto worse = [bidSide](const Level& level, double value) { return bidSide ? level.price < value : level.price > value; };
+	std::vector<Level>& levels = ladder.levels;
+	if (levels.empty() || worse(levels.back(), price)) { // a new best price
+		levels.push_back(Level{price, index, index});
+		return;
+	}
+	auto it = std::lower_bound(levels.begin(), levels.end(), price, worse);
+	if (it->price == price) { // joins the back of its level
+		pool[it->tail].next = index;
+		it->tail = index;
+	} else {
+		levels.insert(it, Level{price, index, index});
+	}
+}
+
+void MatchingEngine::recordSale(size_t product, double price, double amount, uint32_t bidUser, uint32_t askUser) {
+	Sale sale;
+	sale.price = price;
+	sale.amount = amount;
+	sale.product = product;
+	if (bidUser != none) { // a user bought
+		sale.orderType = OrderBookType::bidsale;
+		sale.userOrder = bidUser;
+	} else {
+		sale.orderType = OrderBookType::asksale;
+		sale.userOrder = askUser == none ? noOrder : askUser;
+	}
+	sales.push_back(sale);
+}
+
+const std::vector<Sale>& MatchingEngine::getSales() const {
+	return sales;
+}
+
+const std::vector<UserOrder>& MatchingEngine::getUserOrders() const {
+	return userOrders;
+}
+
+size_t MatchingEngine::getLiveOrderCount() const {
+	return liveOrders;
+}
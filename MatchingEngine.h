@@ -0,0 +1,99 @@
+#pragma once
+#include "OrderBook.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** One match of a bid and an ask */
+struct Sale {
+	/** the price of the order that was resting in the book */
+	double price = 0;
+	double amount = 0;
+	/** index of the product in the OrderBook the sale was matched in */
+	size_t product = 0;
+	/** bidsale when a user bought, asksale otherwise, like the sales of the exchange simulation */
+	OrderBookType orderType = OrderBookType::asksale;
+	/** the user order that took part in the sale, MatchingEngine::noOrder when both orders came from the dataset */
+	size_t userOrder = SIZE_MAX;
+};
+
+/** An order a user submitted, with what is left of it */
+struct UserOrder {
+	std::string username;
+	std::string product;
+	OrderBookType orderType = OrderBookType::bid;
+	double price = 0;
+	/** the amount that has not been matched yet, 0 once it is filled or cancelled */
+	double amount = 0;
+	double filled = 0;
+	bool cancelled = false;
+};
+
+/** Matches the bids and asks of a timestep at price-time priority: the best price first, and the earliest order first within a price.
+	Each side of a product is a ladder, a flat array of price levels sorted so the best price is at the back,
+	and each level is a first in first out list threaded through one pool of orders, so matching only touches the front of the book.
+	The orders of the dataset only live for their timestep, user orders rest in the book until they are filled or cancelled */
+class MatchingEngine {
+	public:
+		static const size_t noOrder = SIZE_MAX;
+
+		MatchingEngine();
+		/** clears the book and matches the sent timestep: the live user orders are placed first as the oldest orders,
+			then the timestep's asks, then its bids arrive one by one in the order of the dataset.
+			getSales() then holds the sales of the timestep */
+		void matchTimestep(const OrderBook& book, size_t timestep);
+		/** true when the book holds the sent timestep of the sent orderbook, as it was indexed when it was matched */
+		bool isAt(const OrderBook& book, size_t timestep) const;
+		/** adds an order of a user to the book of the current timestep, matching it at once against what is left of the timestep.
+			Returns the id of the order, or noOrder if the product is not in the orderbook or the price or amount is not positive */
+		size_t submit(std::string_view username, std::string_view product, OrderBookType orderType, double price, double amount);
+		/** takes a user order out of the book, returns false if it was filled or cancelled already */
+		bool cancel(size_t id);
+
+		/** the sales of the current timestep, in the order they were matched */
+		const std::vector<Sale>& getSales() const;
+		/** every order users submitted, by id */
+		const std::vector<UserOrder>& getUserOrders() const;
+		/** number of user orders that are still resting */
+		size_t getLiveOrderCount() const;
+
+	private:
+		static const uint32_t none = UINT32_MAX;
+		/** an order in the pool, next links it to the following order of its price level */
+		struct RestingOrder {
+			double amount;
+			uint32_t next;
+			/** index into userOrders, none for a dataset order */
+			uint32_t userOrder;
+		};
+		struct Level {
+			double price;
+			uint32_t head;
+			uint32_t tail;
+		};
+		/** the levels of one side of a product. Bids are sorted by rising price and asks by falling price, so the best is at the back */
+		struct Ladder {
+			std::vector<Level> levels;
+		};
+		struct ProductBook {
+			Ladder bids;
+			Ladder asks;
+		};
+
+		/** matches an incoming order against the other side of its product, then rests what is left of it on its own side */
+		void addOrder(size_t product, OrderBookType orderType, double price, double amount, uint32_t userOrder);
+		void rest(Ladder& ladder, bool bidSide, double price, double amount, uint32_t userOrder);
+		void recordSale(size_t product, double price, double amount, uint32_t bidUser, uint32_t askUser);
+
+		std::vector<ProductBook> products;
+		std::vector<RestingOrder> pool;
+		std::vector<Sale> sales;
+		std::vector<UserOrder> userOrders;
+		size_t liveOrders;
+		/** the orderbook and timestep the book holds, nullptr before the first matchTimestep */
+		const OrderBook* currentBook;
+		size_t currentStep;
+		/** OrderBook::getIndexVersion of currentBook when it was matched */
+		size_t currentIndexVersion;
+};
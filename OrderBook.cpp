@@ -1,124 +1,807 @@
-#include "OrderBook.h"
-#include "CSVReader.h"
-#include <iostream>
-#include <map>
-#include <string>
-#include <algorithm>
-
-
-OrderBook::OrderBook(std::string filename) {
-	orders = CSVReader::readCSV(filename);
-
-}
-
-
-std::vector<std::string> OrderBook::getKnownProducts() { // Loops through the dataset and maps true value to the products
-	std::vector<std::string> products;					 // Stores all the available products into a vector of strings and is returned
-	std::map<std::string, bool> prodMap;
-
-	for (OrderBookEntry& e : orders) {
-		prodMap[e.product] = true;
-	}
-
-	for (auto const& e : prodMap) {
-		products.push_back(e.first);
-	}
-
-	return products;
-}
-
-
-std::vector<OrderBookEntry> OrderBook::getOrders(OrderBookType type, std::string product, std::string timestamp) {
-	std::vector<OrderBookEntry> orders_sub;
-	for (OrderBookEntry& e : orders) {
-		if (e.orderType == type &&
-			e.product == product &&
-			e.timestamp == timestamp) {
-			orders_sub.push_back(e);
-		}
-	}
-	return orders_sub;
-}
-
-double OrderBook::getHighPrice(std::vector<OrderBookEntry>& orders) {
-	if (orders.size() == 0) { //if entries for product is empty, print out line
-		std::cout << "This product has no entries" << std::endl;
-		return 0;
-	}
-	else {
-		double max = orders[0].price;
-		for (OrderBookEntry e : orders) {
-			if (e.price > max)max = e.price;
-		}
-		return max;
-	}
-
-}
-
-double OrderBook::getLowPrice(std::vector<OrderBookEntry>& orders) {
-	if (orders.size() == 0) { //if entries for product is empty, print out line
-		std::cout << "This product has no entries" << std::endl;
-		return 0;
-	}
-	else {
-		double min = orders[0].price;
-		for (OrderBookEntry e : orders) {
-			if (e.price < min)min = e.price;
-		}
-		return min;
-	}
-
-}
-
-double OrderBook::getAvgPrice(std::vector<OrderBookEntry>& orders) {
-	double sum = 0;
-	double avg = 0;
-	for (OrderBookEntry e : orders) {
-		sum = sum + e.price;
-		avg = sum / orders.size();
-	}
-
-	return avg;
-}
-
-
-std::string OrderBook::getEarliestTime() {
-	return orders[0].timestamp;
-}
-
-std::string OrderBook::getNextTime(std::string timestamp) {
-	std::string next_timestamp = "";
-	for (OrderBookEntry& e : orders) {
-		if (e.timestamp > timestamp) {
-			next_timestamp = e.timestamp;
-			break;
-		}
-	}
-	if (next_timestamp == "") {
-
-		next_timestamp = orders[0].timestamp;
-	}
-	return next_timestamp;
-}
-
-std::string OrderBook::getPrevTime(std::string timestamp) {
-	std::string prev_timestamp = "";
-	int index = 0;
-	for (OrderBookEntry& e : orders) {
-		if (e.timestamp == timestamp && timestamp != orders[0].timestamp) { // matches current timestep to dataset's timestep & not the first timestep
-			prev_timestamp = orders[index-1].timestamp; // minus 1 to the index to get the previous timestep
-			break;
-		} else {
-			index++;
-		}
-	}
-
-	if (prev_timestamp == "") {
-
-		prev_timestamp = orders[0].timestamp;
-	}
-	return prev_timestamp;
-}
-
-
-
+#include "OrderBook.h"
+#include "CSVReader.h"
+#include "MappedFile.h"
+#include "OrderBookSnapshot.h"
+#include "PriceKernels.h"
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <mutex>
+
+
+namespace {
+	/** the work counted by the queries of this thread, see OrderBook::getQueryCounters */
+	thread_local QueryCounters queryCounters;
+
+	/** milliseconds from start to now, then moves start to now for the next phase */
+	double lap(std::chrono::steady_clock::time_point& start) {
+		auto now = std::chrono::steady_clock::now();
+		double milliseconds = std::chrono::duration<double, std::milli>(now - start).count();
+		start = now;
+		return milliseconds;
+	}
+}
+
+OrderBook::OrderBook(std::string filename, OrderBookOptions options) : live(options.follow), loadedBytes(0), indexVersion(0) {
+	auto start = std::chrono::steady_clock::now();
+	auto phase = start;
+	std::string snapshotFile = OrderBookSnapshot::snapshotFilename(filename);
+	std::string blockFile = BlockFile::blockFilename(filename);
+	if (live) { // a snapshot would not say where the followed file continues, and appendTimestep adds rows in memory
+		options.useSnapshot = false;
+		options.outOfCore = false;
+	}
+	if (options.outOfCore && options.useSnapshot && OrderBookSnapshot::isNewerThan(blockFile, filename) && loadBlocks(blockFile, options.pageBudget)) {
+		loadTimings.total = lap(start);
+		return;
+	}
+	phase = std::chrono::steady_clock::now();
+	if (options.useSnapshot && OrderBookSnapshot::isNewerThan(snapshotFile, filename)) {
+		SnapshotStatus status = OrderBookSnapshot::read(snapshotFile, store, groupOffsets);
+		if (status == SnapshotStatus::ok) {
+			buildTimestepOffsets();
+			loadTimings.fromSnapshot = true;
+			loadTimings.read = lap(phase);
+			buildAggregates();
+			loadTimings.aggregates = lap(phase);
+			buildRangeIndex();
+			loadTimings.rangeIndex = lap(phase);
+			buildSpreadIndex();
+			loadTimings.spreadIndex = lap(phase);
+			buildDepthIndex();
+			loadTimings.depthIndex = lap(phase);
+			if (options.outOfCore) {
+				moveToBlocks(blockFile, options.pageBudget);
+				loadTimings.blockWrite = lap(phase);
+			}
+			loadTimings.total = lap(start);
+			return;
+		}
+		std::cerr << "Ignoring snapshot " << snapshotFile << ": " << OrderBookSnapshot::statusToString(status) << std::endl;
+		phase = std::chrono::steady_clock::now();
+	}
+
+	loadCSV(filename, options.loadThreads); // times its own phases
+	phase = std::chrono::steady_clock::now();
+	buildAggregates();
+	loadTimings.aggregates = lap(phase);
+	buildRangeIndex();
+	loadTimings.rangeIndex = lap(phase);
+	buildSpreadIndex();
+	loadTimings.spreadIndex = lap(phase);
+	buildDepthIndex();
+	loadTimings.depthIndex = lap(phase);
+	if (options.outOfCore) { // the block file stands in for the snapshot on the next start
+		moveToBlocks(blockFile, options.pageBudget);
+		loadTimings.blockWrite = lap(phase);
+	} else if (options.useSnapshot && store.size() > 0) {
+		OrderBookSnapshot::write(snapshotFile, store, groupOffsets); // a failed write only costs the next start a csv parse
+		loadTimings.snapshotWrite = lap(phase);
+	}
+	loadTimings.total = lap(start);
+}
+
+bool OrderBook::loadBlocks(const std::string& blockFilename, size_t pageBudget) {
+	auto phase = std::chrono::steady_clock::now();
+	std::unique_ptr<BlockFile> file{new BlockFile{pageBudget}};
+	// the group statistics are read from the index with the offsets, so no block is decoded until a query needs it
+	SnapshotStatus status = file->open(blockFilename, store, groupOffsets, depthOffsets, groupStats);
+	if (status == SnapshotStatus::ok && groupOffsets.size() != store.timestamps.size() * store.products.size() * orderTypeCount + 1) {
+		status = SnapshotStatus::badFormat; // groups laid out for another number of order types
+	}
+	if (status != SnapshotStatus::ok) {
+		std::cerr << "Ignoring block file " << blockFilename << ": " << OrderBookSnapshot::statusToString(status) << std::endl;
+		return false;
+	}
+	blocks = std::move(file);
+	buildTimestepOffsets();
+	loadTimings.fromBlockFile = true;
+	loadTimings.outOfCore = true;
+	loadTimings.read = lap(phase);
+	buildRangeIndex();
+	loadTimings.rangeIndex = lap(phase);
+	buildSpreadIndex();
+	loadTimings.spreadIndex = lap(phase);
+	return true;
+}
+
+void OrderBook::moveToBlocks(const std::string& blockFilename, size_t pageBudget) {
+	// the ladders are not written, only the order their rows are summed in, so decoding a block builds the same levels again
+	std::vector<uint32_t> ladderOrders, order;
+	for (size_t g = 0; g + 1 < depthOffsets.size(); g++) {
+		if (depthOffsets[g + 1] == depthOffsets[g]) continue;
+		size_t count = groupOffsets[g + 1] - groupOffsets[g];
+		bool bids = static_cast<OrderBookType>(g % orderTypeCount) == OrderBookType::bid;
+		DepthLadder::sortOrder(store.price.data() + groupOffsets[g], count, bids, order);
+		ladderOrders.insert(ladderOrders.end(), order.begin(), order.end());
+	}
+	std::unique_ptr<BlockFile> file{new BlockFile{pageBudget}};
+	if (!BlockFile::write(blockFilename, store, groupOffsets, depthOffsets, ladderOrders, groupStats)
+		|| file->open(blockFilename) != SnapshotStatus::ok) {
+		std::cerr << "Could not write " << blockFilename << ", keeping the rows in memory" << std::endl;
+		return;
+	}
+	blocks = std::move(file);
+	store.releaseRows();
+	depthLevels = std::vector<DepthLevel>{};
+	loadTimings.outOfCore = true;
+}
+
+void OrderBook::loadCSV(std::string filename, unsigned int loadThreads) {
+	auto phase = std::chrono::steady_clock::now();
+	MappedFile csvFile{filename};
+	loadTimings.read = lap(phase);
+	std::string_view text = csvFile.view();
+	if (live) { // the newest timestep may still be being written, the follower adds it when it is complete
+		text = text.substr(0, CSVReader::completeTimestepsLength(text));
+	}
+	loadedBytes = text.size();
+	std::vector<CSVRow> rows;
+	CSVParseResult result = CSVReader::parseCSV(text, rows, loadThreads);
+	if (!csvFile.isOpen()) {
+		std::cerr << "Could not open " << filename << std::endl;
+	} else if (result.badLines > 0) {
+		std::cerr << "Skipped " << result.badLines << " malformed lines in " << filename << ", the first at line " << result.firstBadLine << std::endl;
+	}
+
+	OrderStore loaded;
+	loaded.reserve(rows.size());
+	for (const CSVRow& row : rows) {
+		if (!loaded.append(row.price, row.amount, row.timestamp, row.product, row.orderType)) {
+			std::cerr << "Could not load " << filename << ", it has more than " << OrderStore::maxProducts << " products" << std::endl;
+			loaded = OrderStore{};
+			break;
+		}
+	}
+	loadTimings.parse = lap(phase);
+	buildIndex(loaded);
+	loadTimings.index = lap(phase);
+}
+
+void OrderBook::buildIndex(OrderStore& loaded) { // Counting sort of the rows by (timestep, product, order type), so every query result is a contiguous range
+	// dictionaries are sorted so timestep and product indexes follow the order of their strings
+	std::vector<uint32_t> timestepRank(loaded.timestamps.size());
+	std::vector<uint16_t> productRank(loaded.products.size()); // loaded holds at most OrderStore::maxProducts products
+	std::vector<size_t> byTimestamp(loaded.timestamps.size());
+	std::vector<size_t> byProduct(loaded.products.size());
+	for (size_t i = 0; i < byTimestamp.size(); i++) byTimestamp[i] = i;
+	for (size_t i = 0; i < byProduct.size(); i++) byProduct[i] = i;
+	std::sort(byTimestamp.begin(), byTimestamp.end(), [&loaded](size_t a, size_t b) { return loaded.timestamps[a] < loaded.timestamps[b]; });
+	std::sort(byProduct.begin(), byProduct.end(), [&loaded](size_t a, size_t b) { return loaded.products[a] < loaded.products[b]; });
+
+	store = OrderStore{};
+	for (size_t i = 0; i < byTimestamp.size(); i++) {
+		timestepRank[byTimestamp[i]] = static_cast<uint32_t>(i);
+		store.internTimestamp(loaded.timestamps[byTimestamp[i]]);
+	}
+	for (size_t i = 0; i < byProduct.size(); i++) {
+		productRank[byProduct[i]] = static_cast<uint16_t>(i);
+		store.internProduct(loaded.products[byProduct[i]]);
+	}
+
+	std::vector<size_t> rowGroups(loaded.size());
+	groupOffsets.assign(store.timestamps.size() * store.products.size() * orderTypeCount + 1, 0);
+	for (size_t i = 0; i < loaded.size(); i++) {
+		rowGroups[i] = groupIndex(productRank[loaded.product[i]], static_cast<OrderBookType>(loaded.orderType[i]), timestepRank[loaded.timestep[i]]);
+		groupOffsets[rowGroups[i] + 1]++;
+	}
+	for (size_t g = 1; g < groupOffsets.size(); g++) {
+		groupOffsets[g] += groupOffsets[g - 1];
+	}
+
+	// rows keep their relative order inside a group
+	std::vector<size_t> next(groupOffsets.begin(), groupOffsets.end() - 1);
+	std::vector<size_t> sourceRows(loaded.size());
+	for (size_t i = 0; i < loaded.size(); i++) {
+		sourceRows[next[rowGroups[i]]++] = i;
+	}
+	store.reserve(loaded.size());
+	for (size_t row : sourceRows) {
+		store.appendRow(loaded.price[row],
+						loaded.amount[row],
+						timestepRank[loaded.timestep[row]],
+						productRank[loaded.product[row]],
+						static_cast<OrderBookType>(loaded.orderType[row]));
+	}
+
+	buildTimestepOffsets();
+}
+
+void OrderBook::buildTimestepOffsets() {
+	timestepOffsets.clear();
+	for (size_t t = 0; t <= store.timestamps.size(); t++) { // a timestep starts at its first group
+		timestepOffsets.push_back(groupOffsets[t * store.products.size() * orderTypeCount]);
+	}
+}
+
+void OrderBook::buildAggregates(size_t firstGroup) {
+	groupStats.resize(firstGroup);
+	groupStats.resize(groupOffsets.size() - 1, OrderStats{});
+	summariseGroups(store.price.data(), store.amount.data(), 0, firstGroup, groupOffsets.size() - 1);
+}
+
+void OrderBook::summariseGroups(const double* prices, const double* amounts, size_t firstRow, size_t firstGroup, size_t lastGroup) {
+	for (size_t g = firstGroup; g < lastGroup; g++) {
+		size_t first = groupOffsets[g];
+		size_t last = groupOffsets[g + 1];
+		if (first == last) continue;
+
+		PriceSummary summary = PriceKernels::summarise(prices + (first - firstRow), amounts + (first - firstRow), last - first);
+		OrderStats& stats = groupStats[g];
+		stats.min = summary.min;
+		stats.max = summary.max;
+		stats.priceSum = summary.priceSum;
+		stats.amountSum = summary.amountSum;
+		stats.notional = summary.notional;
+		stats.count = summary.count;
+	}
+}
+
+const OrderStats OrderBook::emptyStats{};
+
+void OrderBook::buildRangeIndex(size_t firstStep) {
+	if (firstStep == 0) {
+		rangeIndex.assign(store.products.size() * 2, TimestepSeries{});
+		for (TimestepSeries& series : rangeIndex) { // every series gets one value per timestep, allocated up front
+			for (RangeSeries* values : {&series.average, &series.low, &series.high, &series.count, &series.priceSum, &series.amountSum, &series.notional}) {
+				values->reserve(store.timestamps.size());
+			}
+		}
+	}
+	for (size_t p = 0; p < store.products.size(); p++) {
+		for (OrderBookType type : {OrderBookType::bid, OrderBookType::ask}) {
+			TimestepSeries& series = rangeIndex[seriesIndex(p, type)];
+			for (size_t t = firstStep; t < store.timestamps.size(); t++) {
+				const OrderStats& stats = groupStats[groupIndex(p, type, t)];
+				bool empty = stats.count == 0;
+				series.average.append(empty ? 0 : stats.priceSum / stats.count);
+				if (empty) {
+					series.low.appendMissing();
+					series.high.appendMissing();
+				} else {
+					series.low.append(stats.min);
+					series.high.append(stats.max);
+				}
+				series.count.append(static_cast<double>(stats.count));
+				series.priceSum.append(stats.priceSum);
+				series.amountSum.append(stats.amountSum);
+				series.notional.append(stats.notional);
+			}
+		}
+	}
+}
+
+void OrderBook::buildSpreadIndex(size_t firstStep) {
+	if (firstStep == 0) {
+		spreadIndex.assign(store.products.size(), SpreadSeries{});
+		for (SpreadSeries& series : spreadIndex) {
+			series.spread.reserve(store.timestamps.size());
+			series.relativeSpread.reserve(store.timestamps.size());
+			series.quoted.reserve(store.timestamps.size());
+		}
+	}
+	for (size_t p = 0; p < store.products.size(); p++) {
+		SpreadSeries& series = spreadIndex[p];
+		for (size_t t = firstStep; t < store.timestamps.size(); t++) {
+			const OrderStats& asks = groupStats[groupIndex(p, OrderBookType::ask, t)];
+			const OrderStats& bids = groupStats[groupIndex(p, OrderBookType::bid, t)];
+			if (asks.count == 0 || bids.count == 0) {
+				series.spread.appendMissing();
+				series.relativeSpread.appendMissing();
+				series.quoted.append(0);
+				continue;
+			}
+			double spread = asks.min - bids.max; // Bid ask spread = min ask - max bid
+			series.spread.append(spread);
+			series.relativeSpread.append(spread / asks.min * 100); // Liquidity % = (bid ask spread / lowest ask price) * 100
+			series.quoted.append(1);
+		}
+	}
+}
+
+void OrderBook::buildDepthIndex(size_t firstGroup) {
+	if (firstGroup == 0) {
+		depthLevels.clear();
+		depthLevels.reserve(store.size()); // at most one level per row
+		depthOffsets.assign(1, 0);
+	}
+	depthOffsets.resize(firstGroup + 1);
+	std::vector<uint32_t> order; // ladder order of the group's rows, reused by every group
+	for (size_t g = firstGroup; g + 1 < groupOffsets.size(); g++) {
+		OrderBookType type = static_cast<OrderBookType>(g % orderTypeCount);
+		if (type == OrderBookType::bid || type == OrderBookType::ask) {
+			const double* prices = store.price.data() + groupOffsets[g];
+			const double* amounts = store.amount.data() + groupOffsets[g];
+			size_t count = groupOffsets[g + 1] - groupOffsets[g];
+			DepthLadder::sortOrder(prices, count, type == OrderBookType::bid, order);
+			DepthLadder::build(prices, amounts, order.data(), count, depthLevels);
+		}
+		depthOffsets.push_back(depthLevels.size());
+	}
+}
+
+size_t OrderBook::seriesIndex(size_t product, OrderBookType type) const {
+	if (type == OrderBookType::bid) return 2 * product;
+	if (type == OrderBookType::ask) return 2 * product + 1;
+	return rangeIndex.size();
+}
+
+size_t OrderBook::groupIndex(size_t product, OrderBookType type, size_t timestep) const {
+	return (timestep * store.products.size() + product) * orderTypeCount + static_cast<size_t>(type);
+}
+
+const std::vector<std::string>& OrderBook::getKnownProducts() const { // products are collected once when the book loads
+	return store.products;
+}
+
+size_t OrderBook::getProductIndex(std::string_view product) const { // hash lookup, the products were interned in sorted order so the index is also their rank
+	return store.findProduct(product);
+}
+
+OrderRange OrderBook::getOrderRange(OrderBookType type, std::string product, size_t timestep) const {
+	return getOrderRange(type, getProductIndex(product), timestep);
+}
+
+OrderRange OrderBook::getOrderRange(OrderBookType type, size_t product, size_t timestep) const {
+	if (product >= store.products.size() || timestep >= store.timestamps.size()) {
+		return OrderRange{};
+	}
+	size_t g = groupIndex(product, type, timestep);
+	size_t first = groupOffsets[g];
+	size_t count = groupOffsets[g + 1] - first;
+	if (!blocks) {
+		return OrderRange{store.price.data() + first, store.amount.data() + first, count, store.timestamps[timestep], &store.products[product], type};
+	}
+	if (count == 0) { // nothing to map
+		return OrderRange{};
+	}
+	std::shared_ptr<const BlockFile::Block> block = blocks->getBlock(blocks->blockOfTimestep(timestep));
+	if (!block) {
+		return OrderRange::unreadable();
+	}
+	const double* prices = block->prices + (first - block->firstRow);
+	const double* amounts = block->amounts + (first - block->firstRow);
+	return OrderRange{prices, amounts, count, store.timestamps[timestep], &store.products[product], type, std::move(block)};
+}
+
+const DepthLevel* OrderBook::depthLevelsFrom(size_t timestep, size_t firstLevel, std::shared_ptr<const BlockFile::Block>& block) const {
+	if (!blocks) {
+		return depthLevels.data() + firstLevel;
+	}
+	block = blocks->getBlock(blocks->blockOfTimestep(timestep));
+	if (!block) {
+		return nullptr;
+	}
+	return block->levels + (firstLevel - block->firstLevel);
+}
+
+const OrderStats& OrderBook::getStats(OrderBookType type, size_t product, size_t timestep) const {
+	if (product >= store.products.size() || timestep >= store.timestamps.size()) {
+		return emptyStats;
+	}
+	queryCounters.timestepsTraversed++;
+	return groupStats[groupIndex(product, type, timestep)];
+}
+
+RangeStats OrderBook::getRangeStats(OrderBookType type, size_t product, size_t firstStep, size_t lastStep) const {
+	RangeStats range;
+	if (product >= store.products.size() || firstStep > lastStep || lastStep >= store.timestamps.size()) {
+		return range;
+	}
+	range.timesteps = lastStep - firstStep + 1;
+
+	size_t s = seriesIndex(product, type);
+	if (s < rangeIndex.size()) {
+		const TimestepSeries& series = rangeIndex[s];
+		range.count = static_cast<size_t>(series.count.sum(firstStep, lastStep) + 0.5);
+		range.averageOfAverages = series.average.mean(firstStep, lastStep);
+		range.priceSum = series.priceSum.sum(firstStep, lastStep);
+		range.amountSum = series.amountSum.sum(firstStep, lastStep);
+		range.notional = series.notional.sum(firstStep, lastStep);
+		if (range.count > 0) {
+			range.min = series.low.min(firstStep, lastStep);
+			range.max = series.high.max(firstStep, lastStep);
+		}
+		return range;
+	}
+
+	// other order types are rare, their groups are combined one timestep at a time
+	queryCounters.timestepsTraversed += range.timesteps;
+	double sumOfAverages = 0;
+	for (size_t t = firstStep; t <= lastStep; t++) {
+		const OrderStats& stats = groupStats[groupIndex(product, type, t)];
+		if (stats.count == 0) continue;
+		if (range.count == 0 || stats.min < range.min) range.min = stats.min;
+		if (range.count == 0 || stats.max > range.max) range.max = stats.max;
+		range.count += stats.count;
+		range.priceSum += stats.priceSum;
+		range.amountSum += stats.amountSum;
+		range.notional += stats.notional;
+		sumOfAverages += stats.priceSum / stats.count;
+	}
+	range.averageOfAverages = sumOfAverages / range.timesteps;
+	return range;
+}
+
+SpreadStats OrderBook::getSpreadStats(size_t product, size_t firstStep, size_t lastStep) const {
+	SpreadStats range;
+	if (product >= store.products.size() || firstStep > lastStep || lastStep >= store.timestamps.size()) {
+		return range;
+	}
+	const SpreadSeries& series = spreadIndex[product];
+	range.timesteps = static_cast<size_t>(series.quoted.sum(firstStep, lastStep) + 0.5);
+	if (range.timesteps == 0) {
+		return range;
+	}
+	range.meanSpread = series.spread.sum(firstStep, lastStep) / range.timesteps;
+	range.meanRelativeSpread = series.relativeSpread.sum(firstStep, lastStep) / range.timesteps;
+	range.minSpread = series.spread.min(firstStep, lastStep);
+	range.maxSpread = series.spread.max(firstStep, lastStep);
+	range.minRelativeSpread = series.relativeSpread.min(firstStep, lastStep);
+	range.maxRelativeSpread = series.relativeSpread.max(firstStep, lastStep);
+	return range;
+}
+
+DepthStats OrderBook::getDepthStats(size_t product, size_t timestep, double percent) const {
+	DepthStats depth;
+	if (product >= store.products.size() || timestep >= store.timestamps.size()) {
+		return depth;
+	}
+	size_t bidGroup = groupIndex(product, OrderBookType::bid, timestep);
+	size_t askGroup = groupIndex(product, OrderBookType::ask, timestep);
+	std::shared_ptr<const BlockFile::Block> block; // keeps the levels in memory when the book is out of core
+	const DepthLevel* bids = depthLevelsFrom(timestep, depthOffsets[bidGroup], block);
+	const DepthLevel* asks = depthLevelsFrom(timestep, depthOffsets[askGroup], block);
+	if (bids == nullptr || asks == nullptr) {
+		depth.unreadable = true;
+		return depth;
+	}
+	const DepthLevel* bidsEnd = bids + (depthOffsets[bidGroup + 1] - depthOffsets[bidGroup]);
+	const DepthLevel* asksEnd = asks + (depthOffsets[askGroup + 1] - depthOffsets[askGroup]);
+	double lowest = -percent, highest = percent; // an infinite percent takes every level, even without a mid
+	if (bids != bidsEnd && asks != asksEnd) {
+		depth.mid = (bids->price + asks->price) / 2;
+		lowest = depth.mid * (1 - percent / 100);
+		highest = depth.mid * (1 + percent / 100);
+	} else if (percent != std::numeric_limits<double>::infinity()) { // a distance from the mid needs both sides
+		return depth;
+	}
+
+	// levels are sorted best first, so the levels within the distance are a prefix of each side
+	const DepthLevel* lastBid = std::partition_point(bids, bidsEnd, [lowest](const DepthLevel& level) { return level.price >= lowest; });
+	const DepthLevel* lastAsk = std::partition_point(asks, asksEnd, [highest](const DepthLevel& level) { return level.price <= highest; });
+	depth.bidLevels = lastBid - bids;
+	depth.askLevels = lastAsk - asks;
+	depth.bidVolume = depth.bidLevels == 0 ? 0 : (lastBid - 1)->cumulativeAmount;
+	depth.askVolume = depth.askLevels == 0 ? 0 : (lastAsk - 1)->cumulativeAmount;
+	if (depth.bidVolume + depth.askVolume > 0) {
+		depth.imbalance = (depth.bidVolume - depth.askVolume) / (depth.bidVolume + depth.askVolume);
+	}
+	return depth;
+}
+
+FillEstimate OrderBook::getFillEstimate(OrderBookType type, size_t product, size_t timestep, double size) const {
+	FillEstimate fill;
+	if (product >= store.products.size() || timestep >= store.timestamps.size() || !(size > 0)
+		|| (type != OrderBookType::bid && type != OrderBookType::ask)) {
+		return fill;
+	}
+	size_t group = groupIndex(product, type == OrderBookType::bid ? OrderBookType::ask : OrderBookType::bid, timestep); // a bid fills against the asks
+	if (depthOffsets[group] == depthOffsets[group + 1]) {
+		return fill;
+	}
+	std::shared_ptr<const BlockFile::Block> block; // keeps the levels in memory when the book is out of core
+	const DepthLevel* levels = depthLevelsFrom(timestep, depthOffsets[group], block);
+	if (levels == nullptr) {
+		fill.unreadable = true;
+		return fill;
+	}
+	const DepthLevel* levelsEnd = levels + (depthOffsets[group + 1] - depthOffsets[group]);
+	const DepthLevel* last = std::partition_point(levels, levelsEnd, [size](const DepthLevel& level) { return level.cumulativeAmount < size; });
+	if (last == levelsEnd) { // the whole side is not enough
+		last--;
+		fill.filled = last->cumulativeAmount;
+		fill.averagePrice = last->cumulativeNotional / last->cumulativeAmount;
+		fill.limitPrice = last->price;
+		return fill;
+	}
+	double amountBefore = last == levels ? 0 : (last - 1)->cumulativeAmount;
+	double notionalBefore = last == levels ? 0 : (last - 1)->cumulativeNotional;
+	fill.filled = size;
+	fill.averagePrice = (notionalBefore + (size - amountBefore) * last->price) / size;
+	fill.limitPrice = last->price;
+	fill.complete = true;
+	return fill;
+}
+
+std::vector<OrderBookEntry> OrderBook::getOrders(OrderBookType type, std::string product, std::string timestamp) const {
+	size_t timestep = getTimestepIndex(timestamp);
+	if (timestep == getTimestepCount()) {
+		return std::vector<OrderBookEntry>{};
+	}
+	return getOrders(type, product, timestep);
+}
+
+std::vector<OrderBookEntry> OrderBook::getOrders(OrderBookType type, std::string product, size_t timestep) const { // compatibility wrapper, copies the rows of the view
+	OrderRange range = getOrderRange(type, product, timestep);
+	queryCounters.rowsScanned += range.size();
+	queryCounters.rowsCopied += range.size();
+	std::vector<OrderBookEntry> orders_sub;
+	orders_sub.reserve(range.size());
+	for (size_t i = 0; i < range.size(); i++) {
+		orders_sub.push_back(range[i]);
+	}
+	return orders_sub;
+}
+
+double OrderBook::getHighPrice(std::vector<OrderBookEntry>& orders) {
+	std::vector<double> prices;
+	for (const OrderBookEntry& e : orders) prices.push_back(e.price);
+	return getHighPrice(prices.data(), prices.size());
+}
+
+double OrderBook::getLowPrice(std::vector<OrderBookEntry>& orders) {
+	std::vector<double> prices;
+	for (const OrderBookEntry& e : orders) prices.push_back(e.price);
+	return getLowPrice(prices.data(), prices.size());
+}
+
+double OrderBook::getAvgPrice(std::vector<OrderBookEntry>& orders) {
+	std::vector<double> prices;
+	for (const OrderBookEntry& e : orders) prices.push_back(e.price);
+	return getAvgPrice(prices.data(), prices.size());
+}
+
+double OrderBook::getHighPrice(const OrderRange& orders) {
+	return getHighPrice(orders.prices(), orders.size());
+}
+
+double OrderBook::getLowPrice(const OrderRange& orders) {
+	return getLowPrice(orders.prices(), orders.size());
+}
+
+double OrderBook::getAvgPrice(const OrderRange& orders) {
+	return getAvgPrice(orders.prices(), orders.size());
+}
+
+double OrderBook::getHighPrice(const double* prices, size_t count) {
+	if (count == 0) {
+		return 0;
+	}
+	queryCounters.rowsScanned += count;
+	return PriceKernels::summarise(prices, nullptr, count).max;
+}
+
+double OrderBook::getLowPrice(const double* prices, size_t count) {
+	if (count == 0) {
+		return 0;
+	}
+	queryCounters.rowsScanned += count;
+	return PriceKernels::summarise(prices, nullptr, count).min;
+}
+
+double OrderBook::getAvgPrice(const double* prices, size_t count) {
+	if (count == 0) {
+		return 0;
+	}
+	queryCounters.rowsScanned += count;
+	return PriceKernels::summarise(prices, nullptr, count).priceSum / count;
+}
+
+double OrderBook::getHighPrice(OrderBookType type, std::string product, size_t timestep) const {
+	const OrderStats& stats = getStats(type, getProductIndex(product), timestep);
+	return stats.max;
+}
+
+double OrderBook::getLowPrice(OrderBookType type, std::string product, size_t timestep) const {
+	const OrderStats& stats = getStats(type, getProductIndex(product), timestep);
+	return stats.min;
+}
+
+double OrderBook::getAvgPrice(OrderBookType type, std::string product, size_t timestep) const {
+	const OrderStats& stats = getStats(type, getProductIndex(product), timestep);
+	if (stats.count == 0) {
+		return 0;
+	}
+	return stats.priceSum / stats.count;
+}
+
+const LoadTimings& OrderBook::getLoadTimings() const {
+	return loadTimings;
+}
+
+const QueryCounters& OrderBook::getQueryCounters() {
+	return queryCounters;
+}
+
+size_t OrderBook::memoryUsage() const {
+	return store.memoryUsage()
+		 + timestepOffsets.capacity() * sizeof(size_t)
+		 + groupOffsets.capacity() * sizeof(size_t)
+		 + groupStats.capacity() * sizeof(OrderStats)
+		 + depthLevels.capacity() * sizeof(DepthLevel)
+		 + depthOffsets.capacity() * sizeof(size_t)
+		 + rangeIndexMemoryUsage()
+		 + getBlockCounters().residentBytes;
+}
+
+bool OrderBook::isOutOfCore() const {
+	return blocks != nullptr;
+}
+
+BlockCacheCounters OrderBook::getBlockCounters() const {
+	return blocks ? blocks->getCounters() : BlockCacheCounters{};
+}
+
+bool OrderBook::appendTimestep(const CSVRow* rows, size_t count) {
+	if (count == 0) {
+		return true;
+	}
+	int64_t timestamp = rows[0].timestamp;
+	std::unique_lock<std::shared_mutex> lock{viewMutex};
+	if (!store.timestamps.empty() && timestamp <= store.timestamps.back()) {
+		return false;
+	}
+
+	bool newProduct = false;
+	for (size_t i = 0; i < count && !newProduct; i++) {
+		newProduct = !std::binary_search(store.products.begin(), store.products.end(), rows[i].product);
+	}
+	if (newProduct) { // the group table is laid out by product, so the book is indexed again with the new product in it
+		OrderStore loaded;
+		loaded.reserve(store.size() + count);
+		for (size_t row = 0; row < store.size(); row++) {
+			loaded.append(store.price[row], store.amount[row], store.timestamps[store.timestep[row]], store.products[store.product[row]], static_cast<OrderBookType>(store.orderType[row]));
+		}
+		for (size_t i = 0; i < count; i++) {
+			if (!loaded.append(rows[i].price, rows[i].amount, timestamp, rows[i].product, rows[i].orderType)) {
+				return false; // the book is left as it was
+			}
+		}
+		buildIndex(loaded);
+		buildAggregates();
+		buildRangeIndex();
+		buildSpreadIndex();
+		buildDepthIndex();
+		indexVersion++;
+		return true;
+	}
+
+	// counting sort of the new rows into the groups of the new timestep
+	size_t timestep = store.timestamps.size();
+	store.internTimestamp(timestamp);
+	size_t groupsPerStep = store.products.size() * orderTypeCount;
+	size_t firstGroup = groupOffsets.size() - 1;
+	std::vector<size_t> rowGroups(count);
+	std::vector<size_t> offsets(groupsPerStep + 1, 0);
+	for (size_t i = 0; i < count; i++) {
+		size_t product = std::lower_bound(store.products.begin(), store.products.end(), rows[i].product) - store.products.begin();
+		rowGroups[i] = product * orderTypeCount + static_cast<size_t>(rows[i].orderType);
+		offsets[rowGroups[i] + 1]++;
+	}
+	for (size_t g = 1; g <= groupsPerStep; g++) {
+		offsets[g] += offsets[g - 1];
+	}
+	std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+	std::vector<size_t> sourceRows(count);
+	for (size_t i = 0; i < count; i++) {
+		sourceRows[next[rowGroups[i]]++] = i;
+	}
+
+	size_t firstRow = store.size();
+	for (size_t g = 1; g <= groupsPerStep; g++) {
+		groupOffsets.push_back(firstRow + offsets[g]);
+	}
+	for (size_t i : sourceRows) {
+		store.appendRow(rows[i].price, rows[i].amount, static_cast<uint32_t>(timestep), static_cast<uint16_t>(rowGroups[i] / orderTypeCount), rows[i].orderType);
+	}
+	timestepOffsets.push_back(store.size());
+
+	buildAggregates(firstGroup);
+	buildRangeIndex(timestep);
+	buildSpreadIndex(timestep);
+	buildDepthIndex(firstGroup);
+	return true;
+}
+
+std::shared_lock<std::shared_mutex> OrderBook::readLock() const {
+	if (!live) {
+		return std::shared_lock<std::shared_mutex>{};
+	}
+	return std::shared_lock<std::shared_mutex>{viewMutex};
+}
+
+size_t OrderBook::getLoadedBytes() const {
+	return loadedBytes;
+}
+
+size_t OrderBook::getIndexVersion() const {
+	return indexVersion;
+}
+
+size_t OrderBook::rangeIndexMemoryUsage() const {
+	size_t bytes = 0;
+	for (const TimestepSeries& series : rangeIndex) {
+		bytes += series.average.memoryUsage() + series.low.memoryUsage() + series.high.memoryUsage()
+			   + series.count.memoryUsage() + series.priceSum.memoryUsage()
+			   + series.amountSum.memoryUsage() + series.notional.memoryUsage();
+	}
+	return bytes;
+}
+
+
+std::string OrderBook::getEarliestTime() const {
+	return Timestamp::format(store.timestamps[0]);
+}
+
+std::string OrderBook::getNextTime(std::string timestamp) const {
+	// first time strictly after the sent one, wrapping around to the start. Text that is not a timestamp also goes to the start
+	int64_t time;
+	if (!Timestamp::parse(timestamp, time)) {
+		return getEarliestTime();
+	}
+	size_t timestep = getTimestepAfter(time);
+	return Timestamp::format(store.timestamps[timestep == store.timestamps.size() ? 0 : timestep]);
+}
+
+std::string OrderBook::getPrevTime(std::string timestamp) const {
+	size_t timestep = getTimestepIndex(timestamp);
+	if (timestep == getTimestepCount()) { // unknown timestamps go back to the first timestep
+		return getEarliestTime();
+	}
+	return Timestamp::format(store.timestamps[getPrevTimestep(timestep)]);
+}
+
+size_t OrderBook::getTimestepCount() const {
+	return store.timestamps.size();
+}
+
+std::string OrderBook::getTimestamp(size_t timestep) const {
+	return Timestamp::format(store.timestamps[timestep]);
+}
+
+int64_t OrderBook::getTime(size_t timestep) const {
+	return store.timestamps[timestep];
+}
+
+size_t OrderBook::getTimestepIndex(std::string timestamp) const {
+	int64_t time;
+	if (!Timestamp::parse(timestamp, time)) {
+		return store.timestamps.size();
+	}
+	return getTimestepIndex(time);
+}
+
+size_t OrderBook::getTimestepIndex(int64_t time) const { // binary search over the sorted time column
+	size_t timestep = getTimestepAtOrAfter(time);
+	if (timestep == store.timestamps.size() || store.timestamps[timestep] != time) {
+		return store.timestamps.size();
+	}
+	return timestep;
+}
+
+size_t OrderBook::getTimestepAtOrAfter(int64_t time) const {
+	return std::lower_bound(store.timestamps.begin(), store.timestamps.end(), time) - store.timestamps.begin();
+}
+
+size_t OrderBook::getTimestepAfter(int64_t time) const {
+	return std::upper_bound(store.timestamps.begin(), store.timestamps.end(), time) - store.timestamps.begin();
+}
+
+size_t OrderBook::getNextTimestep(size_t timestep) const {
+	queryCounters.timestepsTraversed++;
+	if (timestep + 1 >= store.timestamps.size()) {
+		return 0;
+	}
+	return timestep + 1;
+}
+
+size_t OrderBook::getPrevTimestep(size_t timestep) const {
+	queryCounters.timestepsTraversed++;
+	if (timestep == 0) {
+		return 0;
+	}
+	return timestep - 1;
+}
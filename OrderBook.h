@@ -1,34 +1,373 @@
-#pragma once
-#include "OrderBookEntry.h"
-#include "CSVReader.h"
-#include <string>
-#include <vector>
-
-class OrderBook {
-	public:
-		/** construct, reading a csv data file*/
-		OrderBook(std::string filename);
-		/** return vector of all known products in the dataset*/
-		std::vector<std::string> getKnownProducts();
-		/** return vector of Orders according to the sent filters*/
-		std::vector<OrderBookEntry> getOrders(OrderBookType type,
-											  std::string product,
-											  std::string timestamp);
-
-		/** returns the earliest time in the orderbook */
-		std::string getEarliestTime();
-		/** returns the next time after the sent time in the orderbook. If there is no next timestamp, wraps around to the start */
-		std::string getNextTime(std::string timestamp);
-		/** returns the prev timestep after the sent time in the order book, for getting previous timesteps values for compute average command*/
-		std::string getPrevTime(std::string timestamp);
-
-
-		static double getHighPrice(std::vector<OrderBookEntry>& orders);
-		static double getLowPrice(std::vector<OrderBookEntry>& orders);
-		static double getAvgPrice(std::vector<OrderBookEntry>& orders);
-		static double getEMAPrice(std::vector<OrderBookEntry>& orders);
-
-
-	private:
-		std::vector<OrderBookEntry> orders;
-}; 
\ No newline at end of file
+#pragma once
+#include "OrderBookEntry.h"
+#include "CSVReader.h"
+#include "OrderStore.h"
+#include "RangeSeries.h"
+#include "Timestamp.h"
+#include "BlockFile.h"
+#include "DepthLadder.h"
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+/** View over the contiguous rows of one group (timestep, product and type) of an OrderBook. Valid as long as the OrderBook it came from.
+	The rows of an out of core book are in a decoded block, which the view keeps in memory */
+class OrderRange {
+	public:
+		OrderRange() : priceColumn(nullptr), amountColumn(nullptr), count(0), timestamp(0), product(nullptr), orderType(OrderBookType::unknown) {}
+		OrderRange(const double* _prices, const double* _amounts, size_t _count, int64_t _timestamp, const std::string* _product, OrderBookType _orderType,
+				   std::shared_ptr<const BlockFile::Block> _block = nullptr)
+			: priceColumn(_prices), amountColumn(_amounts), count(_count), timestamp(_timestamp), product(_product), orderType(_orderType), block(std::move(_block)) {}
+
+		/** an empty view of rows that are in a block of the block file that cannot be mapped or is corrupt */
+		static OrderRange unreadable() {
+			OrderRange range;
+			range.blockUnreadable = true;
+			return range;
+		}
+
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		/** true when the view is empty because its rows could not be read, rather than because there are none */
+		bool isUnreadable() const { return blockUnreadable; }
+		/** the price and amount columns of the rows in the view */
+		const double* prices() const { return priceColumn; }
+		const double* amounts() const { return amountColumn; }
+		/** builds the OrderBookEntry of row i of the view */
+		OrderBookEntry operator[](size_t i) const { return OrderBookEntry{priceColumn[i], amountColumn[i], timestamp, *product, orderType}; }
+
+	private:
+		const double* priceColumn;
+		const double* amountColumn;
+		size_t count;
+		/** the timestamp, product and type every row of the group shares */
+		int64_t timestamp;
+		const std::string* product;
+		OrderBookType orderType;
+		/** the decoded block the columns are in, empty when the rows are in memory */
+		std::shared_ptr<const BlockFile::Block> block;
+		bool blockUnreadable = false;
+};
+
+/** Statistics of the orders of one product and type in one timestep, computed when the book loads */
+struct OrderStats {
+	double min = 0;
+	double max = 0;
+	/** sum of the prices */
+	double priceSum = 0;
+	/** sum of the amounts */
+	double amountSum = 0;
+	/** sum of price * amount */
+	double notional = 0;
+	size_t count = 0;
+};
+
+/** Statistics of the orders of one product and type over a range of timesteps */
+struct RangeStats {
+	/** lowest and highest price of the range, 0 if it has no orders */
+	double min = 0;
+	double max = 0;
+	/** mean of the average price of each timestep, timesteps without orders count as 0 */
+	double averageOfAverages = 0;
+	double priceSum = 0;
+	double amountSum = 0;
+	double notional = 0;
+	/** number of orders in the range */
+	size_t count = 0;
+	/** number of timesteps in the range */
+	size_t timesteps = 0;
+};
+
+/** Bid-ask spread of one product over a range of timesteps. Spread = lowest ask - highest bid, relative spread = spread / lowest ask * 100 */
+struct SpreadStats {
+	double meanSpread = 0;
+	double minSpread = 0;
+	double maxSpread = 0;
+	double meanRelativeSpread = 0;
+	double minRelativeSpread = 0;
+	double maxRelativeSpread = 0;
+	/** timesteps of the range that had both bids and asks, the others are left out of the statistics */
+	size_t timesteps = 0;
+};
+
+/** Bids and asks of one product in one timestep near the mid price, from the depth ladder */
+struct DepthStats {
+	/** (highest bid + lowest ask) / 2, 0 if a side has no orders */
+	double mid = 0;
+	/** amounts bid and asked at prices within the sent distance of the mid */
+	double bidVolume = 0;
+	double askVolume = 0;
+	/** (bidVolume - askVolume) / (bidVolume + askVolume), from -1 when there are only asks to 1 when there are only bids */
+	double imbalance = 0;
+	/** number of distinct prices the volumes are made of */
+	size_t bidLevels = 0;
+	size_t askLevels = 0;
+	/** the levels are in a block of the block file that cannot be mapped or is corrupt, the other fields are then 0 */
+	bool unreadable = false;
+};
+
+/** What an order of a given size would fill against the other side of one timestep's book */
+struct FillEstimate {
+	/** the amount that can be filled, the size of the order unless the side holds less */
+	double filled = 0;
+	/** amount weighted average price of the fill, 0 if nothing fills */
+	double averagePrice = 0;
+	/** the worst price the fill reaches */
+	double limitPrice = 0;
+	/** false when the side holds less than the size */
+	bool complete = false;
+	/** the levels are in a block of the block file that cannot be mapped or is corrupt, the other fields are then 0 */
+	bool unreadable = false;
+};
+
+/** Work done by the queries of one thread, counted as they run. Read it before and after a command to get the work of the command */
+struct QueryCounters {
+	/** order rows read one by one, by getOrders and the price functions over rows */
+	uint64_t rowsScanned = 0;
+	/** order rows copied into OrderBookEntry objects by getOrders */
+	uint64_t rowsCopied = 0;
+	/** timesteps looked at one at a time. Ranges answered from the range and spread indexes do not walk their timesteps and add none */
+	uint64_t timestepsTraversed = 0;
+};
+
+/** Milliseconds spent in each phase of loading an OrderBook. Phases that did not run are 0 */
+struct LoadTimings {
+	/** set when the rows came from a snapshot, then read is the snapshot read and parse and index are 0 */
+	bool fromSnapshot = false;
+	double read = 0;
+	double parse = 0;
+	double index = 0;
+	double aggregates = 0;
+	double rangeIndex = 0;
+	double spreadIndex = 0;
+	double depthIndex = 0;
+	double snapshotWrite = 0;
+	/** set when the book is out of core, then blockWrite is the time spent writing its block file */
+	bool outOfCore = false;
+	/** set when an out of core book was opened from its block file, then read is reading the block index and aggregates summarise the blocks */
+	bool fromBlockFile = false;
+	double blockWrite = 0;
+	double total = 0;
+};
+
+/** Settings for loading an OrderBook */
+struct OrderBookOptions {
+	/** threads used to parse the csv file, 0 uses one per hardware thread */
+	unsigned int loadThreads = 0;
+	/** load from a snapshot next to the csv file when it is newer, and write one after parsing the csv */
+	bool useSnapshot = true;
+	/** the csv file is still being appended to: only load the timesteps before its newest timestamp, which may be incomplete,
+		and lock the book while appendTimestep changes it. Snapshots are not used */
+	bool follow = false;
+	/** keep the rows and depth ladders in a compressed block file next to the csv file and decode only the blocks queries touch,
+		instead of holding every row in memory. A followed book is always kept in memory */
+	bool outOfCore = false;
+	/** bytes of decoded blocks an out of core book keeps in memory */
+	size_t pageBudget = 64 * 1024 * 1024;
+};
+
+class OrderBook {
+	public:
+		/** construct, reading a csv data file, or its snapshot when it is up to date*/
+		OrderBook(std::string filename, OrderBookOptions options = OrderBookOptions{});
+		/** return vector of all known products in the dataset, without copying it. A followed book can change it when it is not read locked*/
+		const std::vector<std::string>& getKnownProducts() const;
+		/** returns the index of the sent product in getKnownProducts(), or getKnownProducts().size() if it is not in the orderbook */
+		size_t getProductIndex(std::string_view product) const;
+		/** return the Orders matching the sent filters as a view, without copying them*/
+		OrderRange getOrderRange(OrderBookType type,
+								 std::string product,
+								 size_t timestep) const;
+		/** return the Orders matching the sent filters as a view, product is an index from getProductIndex.
+			Out of core, the view isUnreadable when its block cannot be mapped or is corrupt*/
+		OrderRange getOrderRange(OrderBookType type,
+								 size_t product,
+								 size_t timestep) const;
+		/** return the precomputed statistics of the Orders matching the sent filters, product is an index from getProductIndex*/
+		const OrderStats& getStats(OrderBookType type,
+								   size_t product,
+								   size_t timestep) const;
+		/** return the statistics of the Orders matching the sent filters over timesteps firstStep to lastStep, both included.
+			Answered from prefix sums and segment trees for bids and asks, without walking the timesteps*/
+		RangeStats getRangeStats(OrderBookType type,
+								 size_t product,
+								 size_t firstStep,
+								 size_t lastStep) const;
+		/** return the bid-ask spread statistics of the product over timesteps firstStep to lastStep, both included.
+			The spread series is computed once when the book loads*/
+		SpreadStats getSpreadStats(size_t product,
+								   size_t firstStep,
+								   size_t lastStep) const;
+		/** return the bids and asks of the product at timestep priced within percent % of the mid price, an infinite percent takes the
+			whole book. Answered by binary search over the depth ladder built when the book loads*/
+		DepthStats getDepthStats(size_t product,
+								 size_t timestep,
+								 double percent) const;
+		/** return what a bid (buying) or ask (selling) of size would fill against the asks or bids of the product at timestep,
+			best price first. Answered by binary search over the cumulative amounts of the depth ladder*/
+		FillEstimate getFillEstimate(OrderBookType type,
+									 size_t product,
+									 size_t timestep,
+									 double size) const;
+		/** return vector of Orders according to the sent filters*/
+		std::vector<OrderBookEntry> getOrders(OrderBookType type,
+											  std::string product,
+											  std::string timestamp) const;
+		/** return vector of Orders according to the sent filters, only scanning the rows of the sent timestep*/
+		std::vector<OrderBookEntry> getOrders(OrderBookType type,
+											  std::string product,
+											  size_t timestep) const;
+
+		/** returns the earliest time in the orderbook */
+		std::string getEarliestTime() const;
+		/** returns the next time after the sent time in the orderbook. If there is no next timestamp, wraps around to the start */
+		std::string getNextTime(std::string timestamp) const;
+		/** returns the prev timestep after the sent time in the order book, for getting previous timesteps values for compute average command*/
+		std::string getPrevTime(std::string timestamp) const;
+
+		/** returns the number of distinct timesteps in the orderbook */
+		size_t getTimestepCount() const;
+		/** returns the timestamp of the sent timestep index, formatted from its time */
+		std::string getTimestamp(size_t timestep) const;
+		/** returns the time of the sent timestep index in microseconds since 1970, see Timestamp */
+		int64_t getTime(size_t timestep) const;
+		/** returns the timestep index of the sent timestamp, or getTimestepCount() if the timestamp is not in the orderbook */
+		size_t getTimestepIndex(std::string timestamp) const;
+		size_t getTimestepIndex(int64_t time) const;
+		/** returns the first timestep at or after the sent time, or getTimestepCount() if there is none. Binary search over the time column */
+		size_t getTimestepAtOrAfter(int64_t time) const;
+		/** returns the first timestep after the sent time, or getTimestepCount() if there is none */
+		size_t getTimestepAfter(int64_t time) const;
+		/** returns the timestep index after the sent one. If there is no next timestep, wraps around to the start */
+		size_t getNextTimestep(size_t timestep) const;
+		/** returns the timestep index before the sent one, stays on the first timestep */
+		size_t getPrevTimestep(size_t timestep) const;
+
+		/** highest, lowest and average price of the sent orders, 0 when there are none.
+			Nothing is printed, callers that tell the user about a product without orders check the count first */
+		static double getHighPrice(std::vector<OrderBookEntry>& orders);
+		static double getLowPrice(std::vector<OrderBookEntry>& orders);
+		static double getAvgPrice(std::vector<OrderBookEntry>& orders);
+		static double getEMAPrice(std::vector<OrderBookEntry>& orders);
+		static double getHighPrice(const OrderRange& orders);
+		static double getLowPrice(const OrderRange& orders);
+		static double getAvgPrice(const OrderRange& orders);
+		static double getHighPrice(const double* prices, size_t count);
+		static double getLowPrice(const double* prices, size_t count);
+		static double getAvgPrice(const double* prices, size_t count);
+		/** the same statistics, looked up in the aggregate table instead of scanning the orders */
+		double getHighPrice(OrderBookType type, std::string product, size_t timestep) const;
+		double getLowPrice(OrderBookType type, std::string product, size_t timestep) const;
+		double getAvgPrice(OrderBookType type, std::string product, size_t timestep) const;
+
+		/** how long the phases of loading the orderbook took */
+		const LoadTimings& getLoadTimings() const;
+		/** the work counted so far by the queries run on this thread, over every orderbook */
+		static const QueryCounters& getQueryCounters();
+
+		/** returns the approximate number of bytes held by the rows and indexes of the orderbook, counting the decoded blocks of an out of core book */
+		size_t memoryUsage() const;
+		/** true when the rows are in a block file, see OrderBookOptions::outOfCore */
+		bool isOutOfCore() const;
+		/** the block cache counters of an out of core book, all 0 for a book in memory */
+		BlockCacheCounters getBlockCounters() const;
+
+		/** adds the sent rows as a new timestep after the last one, updating every table in O(rows + products).
+			The rows must share one timestamp. Returns false and skips them if it is not newer than the last timestep,
+			or if their new products would take the book past OrderStore::maxProducts.
+			A product that is not in the book yet re-indexes the whole book. Only for books loaded with follow */
+		bool appendTimestep(const CSVRow* rows, size_t count);
+		/** hold the returned lock while querying to see the book as it was when locking, between appendTimestep calls.
+			Books loaded without follow never change and are not locked */
+		std::shared_lock<std::shared_mutex> readLock() const;
+		/** bytes of the csv file that were loaded, a follower continues from here */
+		size_t getLoadedBytes() const;
+		/** changes when appendTimestep indexes the book again for a new product. Product indexes taken before the change are not valid after it */
+		size_t getIndexVersion() const;
+
+
+	private:
+		/** parses the csv file into the store */
+		void loadCSV(std::string filename, unsigned int loadThreads);
+		/** opens the block file, reading its index and group statistics without decoding any block, returns false if it cannot be used */
+		bool loadBlocks(const std::string& blockFilename, size_t pageBudget);
+		/** writes the rows and depth ladders to the block file and drops them from memory, keeping them if the file cannot be written */
+		void moveToBlocks(const std::string& blockFilename, size_t pageBudget);
+		/** sorts the loaded rows by (timestamp, product, order type) into the store and builds the timestep and group tables over them */
+		void buildIndex(OrderStore& loaded);
+		/** derives the timestep table from the group table */
+		void buildTimestepOffsets();
+		/** computes the statistics of the groups from firstGroup on, in one pass over their rows */
+		void buildAggregates(size_t firstGroup = 0);
+		/** computes the statistics of groups firstGroup to lastGroup - 1 from the columns of their rows, prices[0] being row firstRow */
+		void summariseGroups(const double* prices, const double* amounts, size_t firstRow, size_t firstGroup, size_t lastGroup);
+		/** builds the per timestep series of the bids and asks of every product from the group statistics, from firstStep on */
+		void buildRangeIndex(size_t firstStep = 0);
+		/** builds the per timestep spread series of every product from the group statistics, from firstStep on */
+		void buildSpreadIndex(size_t firstStep = 0);
+		/** builds the price levels of the bid and ask groups from firstGroup on, sorting each group's rows once */
+		void buildDepthIndex(size_t firstGroup = 0);
+		/** index into groupOffsets of the rows with the sent product, type and timestep */
+		size_t groupIndex(size_t product, OrderBookType type, size_t timestep) const;
+
+		/** number of values of OrderBookType, the innermost key of the group table */
+		static const size_t orderTypeCount = 5;
+
+		/** rows grouped by timestep, product and type. Its time and product dictionaries are in ascending order,
+			so timestep i is at time store.timestamps[i] and product indexes match getKnownProducts() */
+		OrderStore store;
+		/** rows of timestep i are timestepOffsets[i] to timestepOffsets[i + 1] - 1 */
+		std::vector<size_t> timestepOffsets;
+		/** rows of group g (see groupIndex) are groupOffsets[g] to groupOffsets[g + 1] - 1 */
+		std::vector<size_t> groupOffsets;
+		/** statistics of group g (see groupIndex) */
+		std::vector<OrderStats> groupStats;
+		/** returned for queries outside the book */
+		static const OrderStats emptyStats;
+
+		/** per timestep series of the statistics of one product and type */
+		struct TimestepSeries {
+			RangeSeries average{RangeSeries::sums};
+			RangeSeries low{RangeSeries::minimum};
+			RangeSeries high{RangeSeries::maximum};
+			RangeSeries count{RangeSeries::sums};
+			RangeSeries priceSum{RangeSeries::sums};
+			RangeSeries amountSum{RangeSeries::sums};
+			RangeSeries notional{RangeSeries::sums};
+		};
+		/** series of product p are rangeIndex[2 * p] for bids and rangeIndex[2 * p + 1] for asks */
+		std::vector<TimestepSeries> rangeIndex;
+		/** index into rangeIndex, or rangeIndex.size() for types that have no series */
+		size_t seriesIndex(size_t product, OrderBookType type) const;
+
+		/** per timestep spread series of one product. Timesteps missing a side are appended as missing */
+		struct SpreadSeries {
+			RangeSeries spread;
+			RangeSeries relativeSpread;
+			/** 1 for timesteps that have both bids and asks */
+			RangeSeries quoted{RangeSeries::sums};
+		};
+		/** spread series of product p */
+		std::vector<SpreadSeries> spreadIndex;
+
+		/** price levels of every group, best first: bids by falling price, asks by rising price. Other types have none */
+		std::vector<DepthLevel> depthLevels;
+		/** levels of group g (see groupIndex) are depthLevels[depthOffsets[g]] to depthLevels[depthOffsets[g + 1] - 1] */
+		std::vector<size_t> depthOffsets;
+		/** the depth levels of the book from level firstLevel on, which must be in timestep. Out of core the block of the timestep is
+			decoded and kept in block, nullptr is returned if it cannot be */
+		const DepthLevel* depthLevelsFrom(size_t timestep, size_t firstLevel, std::shared_ptr<const BlockFile::Block>& block) const;
+		/** the rows and depth ladders of an out of core book, nullptr when they are in memory. Its dictionaries stay in store */
+		std::unique_ptr<BlockFile> blocks;
+		size_t rangeIndexMemoryUsage() const;
+
+		LoadTimings loadTimings;
+		/** set for books loaded with follow, which lock viewMutex */
+		bool live;
+		size_t loadedBytes;
+		size_t indexVersion;
+		/** shared by readers, held alone by appendTimestep */
+		mutable std::shared_mutex viewMutex;
+};
@@ -1,35 +1,37 @@
-#pragma once
-#include <string>
-
-enum class OrderBookType {bid, ask, unknown, asksale, bidsale};
-
-class OrderBookEntry {
-
-public:
-	OrderBookEntry(double _price,
-				   double _amount,
-				   std::string _timestamp,
-				   std::string _product,
-				   OrderBookType _orderType,
-				   std::string username = "dataset");
-	static OrderBookType stringToOrderBookType(std::string s);
-
-	static bool compareByTimestamp(OrderBookEntry& e1, OrderBookEntry& e2) {
-		return e1.timestamp < e2.timestamp;
-	}
-
-	static bool compareByPriceAsc(OrderBookEntry& e1, OrderBookEntry& e2) {
-		return e1.price < e2.price;
-	}
-
-	static bool compareByPriceDesc(OrderBookEntry& e1, OrderBookEntry& e2) {
-		return e1.price > e2.price;
-	}
-
-	double price;
-	double amount;
-	std::string timestamp;
-	std::string product;
-	OrderBookType orderType;
-	std::string username;
+#pragma once
+#include <cstdint>
+#include <string>
+
+enum class OrderBookType {bid, ask, unknown, asksale, bidsale};
+
+class OrderBookEntry {
+
+public:
+	OrderBookEntry(double _price,
+				   double _amount,
+				   int64_t _timestamp,
+				   std::string _product,
+				   OrderBookType _orderType,
+				   std::string username = "dataset");
+	static OrderBookType stringToOrderBookType(std::string s);
+
+	static bool compareByTimestamp(const OrderBookEntry& e1, const OrderBookEntry& e2) {
+		return e1.timestamp < e2.timestamp;
+	}
+
+	static bool compareByPriceAsc(const OrderBookEntry& e1, const OrderBookEntry& e2) {
+		return e1.price < e2.price;
+	}
+
+	static bool compareByPriceDesc(const OrderBookEntry& e1, const OrderBookEntry& e2) {
+		return e1.price > e2.price;
+	}
+
+	double price;
+	double amount;
+	/** microseconds since 1970/01/01 00:00:00, see Timestamp */
+	int64_t timestamp;
+	std::string product;
+	OrderBookType orderType;
+	std::string username;
 };
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "OrderBookSnapshot.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+// File layout, all integers in host byte order:
+//   header     see SnapshotHeader
+//   products   productCount times (uint32 length, bytes)
+//   padding to 8 bytes, then timestepCount int64 timestamps (microseconds since 1970, see Timestamp)
+//   then the columns price, amount (double), timestep (uint32), product (uint16), orderType (uint8)
+//   padding to 8 bytes, then groupCount uint64 group offsets
+// The checksum covers everything after the header.
+
+namespace {
+	const char snapshotMagic[8] = {'A', 'D', 'V', 'S', 'N', 'A', 'P', '\0'};
+	const uint32_t byteOrderMark = 0x01020304;
+
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t rowCount;
+		uint64_t timestepCount;
+		uint64_t productCount;
+		uint64_t groupCount;
+		uint64_t payloadSize;
+		uint64_t checksum;
+	};
+
+	void appendBytes(std::vector<char>& out, const void* data, size_t size) {
+		const char* bytes = static_cast<const char*>(data);
+		out.insert(out.end(), bytes, bytes + size);
+	}
+
+	template <typename Strings>
+	void appendStrings(std::vector<char>& out, const Strings& strings) {
+		for (std::string_view s : strings) {
+			uint32_t length = static_cast<uint32_t>(s.size());
+			appendBytes(out, &length, sizeof(length));
+			appendBytes(out, s.data(), s.size());
+		}
+	}
+
+	void pad(std::vector<char>& out) {
+		while (out.size() % 8 != 0) out.push_back('\0');
+	}
+
+	/** reads count length-prefixed strings from p as views into the buffer, returns false if they run past end */
+	bool readStrings(const char*& p, const char* end, uint64_t count, std::vector<std::string_view>& strings) {
+		for (uint64_t i = 0; i < count; i++) {
+			uint32_t length;
+			if (end - p < static_cast<ptrdiff_t>(sizeof(length))) return false;
+			std::memcpy(&length, p, sizeof(length));
+			p += sizeof(length);
+			if (static_cast<uint64_t>(end - p) < length) return false;
+			strings.emplace_back(p, length);
+			p += length;
+		}
+		return true;
+	}
+
+	template <typename T>
+	bool readColumn(const char*& p, const char* end, uint64_t count, std::vector<T>& column) {
+		if (static_cast<uint64_t>(end - p) / sizeof(T) < count) return false;
+		column.resize(count);
+		std::memcpy(column.data(), p, count * sizeof(T));
+		p += count * sizeof(T);
+		return true;
+	}
+
+	void skipPadding(const char*& p, const char* begin) {
+		while ((p - begin) % 8 != 0) p++;
+	}
+
+	/** the group table of an OrderBook has a group for every timestep, product and order type, in that order */
+	const uint64_t orderTypeCount = static_cast<uint64_t>(OrderBookType::bidsale) + 1;
+
+	/** true if values only grow */
+	template <typename T>
+	bool isAscending(const std::vector<T>& values) {
+		return std::adjacent_find(values.begin(), values.end(), [](const T& a, const T& b) { return !(a < b); }) == values.end();
+	}
+
+	/** true if the offsets start at 0, never decrease and end at the last row, and every row sits in the group
+		of its own timestep, product and order type. Queries index the columns with these values unchecked */
+	bool isGroupTable(const OrderStore& store, const std::vector<uint64_t>& offsets) {
+		if (offsets.size() != store.timestamps.size() * store.products.size() * orderTypeCount + 1
+			|| offsets.front() != 0 || offsets.back() != store.size()) {
+			return false;
+		}
+		for (size_t group = 0; group + 1 < offsets.size(); group++) {
+			if (offsets[group] > offsets[group + 1]) {
+				return false;
+			}
+			uint64_t groupType = group % orderTypeCount;
+			uint64_t groupProduct = group / orderTypeCount % store.products.size();
+			uint64_t groupTimestep = group / orderTypeCount / store.products.size();
+			for (uint64_t row = offsets[group]; row < offsets[group + 1]; row++) {
+				if (store.orderType[row] != groupType || store.product[row] != groupProduct || store.timestep[row] != groupTimestep) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+OrderBookSnapshot::OrderBookSnapshot() {
+
+}
+
+bool OrderBookSnapshot::write(const std::string& filename, const OrderStore& store, const std::vector<size_t>& groupOffsets) {
+	std::vector<char> payload;
+	payload.reserve(store.size() * 23 + groupOffsets.size() * 8 + 4096);
+	appendStrings(payload, store.products);
+	pad(payload);
+	appendBytes(payload, store.timestamps.data(), store.timestamps.size() * sizeof(int64_t));
+	appendBytes(payload, store.price.data(), store.price.size() * sizeof(double));
+	appendBytes(payload, store.amount.data(), store.amount.size() * sizeof(double));
+	appendBytes(payload, store.timestep.data(), store.timestep.size() * sizeof(uint32_t));
+	appendBytes(payload, store.product.data(), store.product.size() * sizeof(uint16_t));
+	appendBytes(payload, store.orderType.data(), store.orderType.size() * sizeof(uint8_t));
+	pad(payload);
+	for (size_t offset : groupOffsets) {
+		uint64_t value = offset;
+		appendBytes(payload, &value, sizeof(value));
+	}
+
+	SnapshotHeader header{};
+	std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+	header.version = version;
+	header.byteOrder = byteOrderMark;
+	header.rowCount = store.size();
+	header.timestepCount = store.timestamps.size();
+	header.productCount = store.products.size();
+	header.groupCount = groupOffsets.size();
+	header.payloadSize = payload.size();
+	header.checksum = checksum(payload.data(), payload.size());
+
+	// written under a temporary name and renamed, so a half written snapshot is never picked up
+	std::string tempFilename = filename + ".tmp";
+	{
+		std::ofstream out{tempFilename, std::ios::binary | std::ios::trunc};
+		if (!out.is_open()) {
+			return false;
+		}
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(payload.data(), payload.size());
+		if (!out.good()) {
+			out.close();
+			std::remove(tempFilename.c_str());
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempFilename, filename, error);
+	if (error) {
+		std::remove(tempFilename.c_str());
+		return false;
+	}
+	return true;
+}
+
+SnapshotStatus OrderBookSnapshot::read(const std::string& filename, OrderStore& store, std::vector<size_t>& groupOffsets) {
+	MappedFile file{filename};
+	if (!file.isOpen()) {
+		return SnapshotStatus::missing;
+	}
+
+	SnapshotHeader header;
+	if (file.size() < sizeof(header)) {
+		return SnapshotStatus::badFormat;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0) {
+		return SnapshotStatus::badFormat;
+	}
+	if (header.version != version || header.byteOrder != byteOrderMark) {
+		return SnapshotStatus::badVersion;
+	}
+	if (header.payloadSize != file.size() - sizeof(header)) {
+		return SnapshotStatus::badFormat;
+	}
+	const char* begin = file.data() + sizeof(header);
+	const char* end = begin + header.payloadSize;
+	if (checksum(begin, header.payloadSize) != header.checksum) {
+		return SnapshotStatus::badChecksum;
+	}
+	if (header.productCount > OrderStore::maxProducts) {
+		return SnapshotStatus::badFormat;
+	}
+
+	OrderStore loaded;
+	std::vector<std::string_view> products; // views into the mapped file, copied into the store before it is unmapped
+	std::vector<int64_t> timestamps;
+	std::vector<uint64_t> offsets;
+	const char* p = begin;
+	bool complete = readStrings(p, end, header.productCount, products);
+	skipPadding(p, begin);
+	complete = complete
+			&& readColumn(p, end, header.timestepCount, timestamps)
+			&& readColumn(p, end, header.rowCount, loaded.price)
+			&& readColumn(p, end, header.rowCount, loaded.amount)
+			&& readColumn(p, end, header.rowCount, loaded.timestep)
+			&& readColumn(p, end, header.rowCount, loaded.product)
+			&& readColumn(p, end, header.rowCount, loaded.orderType);
+	skipPadding(p, begin);
+	complete = complete && readColumn(p, end, header.groupCount, offsets);
+	// the dictionaries are sorted, which also rules out repeated entries
+	if (!complete || !isAscending(products) || !isAscending(timestamps)) {
+		return SnapshotStatus::badFormat;
+	}
+
+	loaded.timestamps.reserve(timestamps.size());
+	for (std::string_view product : products) loaded.internProduct(product);
+	for (int64_t timestamp : timestamps) loaded.internTimestamp(timestamp);
+	if (!isGroupTable(loaded, offsets)) {
+		return SnapshotStatus::badFormat;
+	}
+	store = std::move(loaded);
+	groupOffsets.assign(offsets.begin(), offsets.end());
+	return SnapshotStatus::ok;
+}
+
+bool OrderBookSnapshot::isNewerThan(const std::string& snapshotFile, const std::string& sourceFile) {
+	std::error_code error;
+	auto snapshotTime = std::filesystem::last_write_time(snapshotFile, error);
+	if (error) return false;
+	auto sourceTime = std::filesystem::last_write_time(sourceFile, error);
+	if (error) return true; // the snapshot can stand in for a csv file that is no longer there
+	return snapshotTime > sourceTime;
+}
+
+std::string OrderBookSnapshot::snapshotFilename(const std::string& csvFilename) {
+	return csvFilename + ".snapshot";
+}
+
+std::string OrderBookSnapshot::statusToString(SnapshotStatus status) {
+	switch (status) {
+		case SnapshotStatus::ok: return "ok";
+		case SnapshotStatus::missing: return "missing";
+		case SnapshotStatus::badFormat: return "not a snapshot or truncated";
+		case SnapshotStatus::badVersion: return "written by another version";
+		case SnapshotStatus::badChecksum: return "checksum mismatch";
+	}
+	return "unknown";
+}
+
+uint64_t OrderBookSnapshot::checksum(const char* data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	const uint64_t prime = 0x100000001b3ULL;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+	for (; i < size; i++) {
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+	}
+	return hash;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "OrderStore.h"
+#include <string>
+#include <vector>
+
+enum class SnapshotStatus {ok, missing, badFormat, badVersion, badChecksum};
+
+/** Versioned binary image of a loaded OrderBook: the column store, its dictionaries and the group table.
+	It is written once after a csv load and mapped back in on later starts instead of parsing the csv again */
+class OrderBookSnapshot {
+	public:
+		OrderBookSnapshot();
+		/** writes the sent store and group table to filename, replacing it. Returns false if the file cannot be written */
+		static bool write(const std::string& filename, const OrderStore& store, const std::vector<size_t>& groupOffsets);
+		/** maps filename and reads it into store and groupOffsets. They are left untouched unless ok is returned.
+			A file whose rows do not sit in the groups of their timestep, product and order type is badFormat */
+		static SnapshotStatus read(const std::string& filename, OrderStore& store, std::vector<size_t>& groupOffsets);
+		/** true if snapshotFile exists and was written after sourceFile was last modified */
+		static bool isNewerThan(const std::string& snapshotFile, const std::string& sourceFile);
+		/** returns the file name of the snapshot kept next to a csv file */
+		static std::string snapshotFilename(const std::string& csvFilename);
+		/** describes the sent status for messages */
+		static std::string statusToString(SnapshotStatus status);
+
+		/** checksum of a payload, mixes 8 bytes at a time */
+		static uint64_t checksum(const char* data, size_t size);
+
+		/** bumped whenever the layout below changes, older snapshots are then rejected and rebuilt */
+		static const uint32_t version = 2;
+};
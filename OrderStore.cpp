@@ -0,0 +1,94 @@
+#include "OrderStore.h"
+
+OrderStore::OrderStore() : lastProduct(0) {
+
+}
+
+bool OrderStore::append(double _price,
+						double _amount,
+						int64_t _timestamp,
+						std::string_view _product,
+						OrderBookType _orderType) {
+	if (products.size() >= maxProducts && findProduct(_product) == products.size()) {
+		return false;
+	}
+	appendRow(_price, _amount, internTimestamp(_timestamp), internProduct(_product), _orderType);
+	return true;
+}
+
+void OrderStore::appendRow(double _price, double _amount, uint32_t _timestep, uint16_t _product, OrderBookType _orderType) {
+	price.push_back(_price);
+	amount.push_back(_amount);
+	timestep.push_back(_timestep);
+	product.push_back(_product);
+	orderType.push_back(static_cast<uint8_t>(_orderType));
+}
+
+void OrderStore::reserve(size_t rows) {
+	price.reserve(rows);
+	amount.reserve(rows);
+	timestep.reserve(rows);
+	product.reserve(rows);
+	orderType.reserve(rows);
+}
+
+void OrderStore::releaseRows() {
+	price = std::vector<double>{};
+	amount = std::vector<double>{};
+	timestep = std::vector<uint32_t>{};
+	product = std::vector<uint16_t>{};
+	orderType = std::vector<uint8_t>{};
+}
+
+size_t OrderStore::size() const {
+	return price.size();
+}
+
+OrderBookEntry OrderStore::getEntry(size_t row) const {
+	return OrderBookEntry{price[row],
+						  amount[row],
+						  timestamps[timestep[row]],
+						  products[product[row]],
+						  static_cast<OrderBookType>(orderType[row])};
+}
+
+size_t OrderStore::memoryUsage() const {
+	size_t bytes = price.capacity() * sizeof(double)
+				 + amount.capacity() * sizeof(double)
+				 + timestep.capacity() * sizeof(uint32_t)
+				 + product.capacity() * sizeof(uint16_t)
+				 + orderType.capacity() * sizeof(uint8_t);
+	bytes += timestamps.capacity() * sizeof(int64_t);
+	for (const std::string& s : products) bytes += sizeof(std::string) + (s.capacity() > 15 ? s.capacity() : 0);
+	return bytes;
+}
+
+uint32_t OrderStore::internTimestamp(int64_t _timestamp) {
+	if (!timestamps.empty() && timestamps.back() == _timestamp) { // rows of a timestep arrive together, so this is the common case
+		return static_cast<uint32_t>(timestamps.size() - 1);
+	}
+	size_t id = timestampIndex.find(timestamps, _timestamp);
+	if (id < timestamps.size()) {
+		return static_cast<uint32_t>(id);
+	}
+	timestamps.push_back(_timestamp);
+	timestampIndex.insert(timestamps, id);
+	return static_cast<uint32_t>(id);
+}
+
+uint16_t OrderStore::internProduct(std::string_view _product) {
+	if (!products.empty() && products[lastProduct] == _product) { // rows of a product arrive together in the datasets
+		return lastProduct;
+	}
+	size_t id = productIndex.find(products, _product);
+	if (id == products.size()) {
+		products.emplace_back(_product); // product names fit in the small string buffer, so this does not allocate
+		productIndex.insert(products, id);
+	}
+	lastProduct = static_cast<uint16_t>(id);
+	return lastProduct;
+}
+
+size_t OrderStore::findProduct(std::string_view _product) const {
+	return productIndex.find(products, _product);
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** Columnar storage for the rows of an OrderBook. Each field is kept in its own contiguous array, and
+	products and timestamps are stored once in dictionaries that the rows refer to by index.
+	Timestamps are kept as microseconds since 1970 (see Timestamp), and the dictionaries are looked up
+	through flat hash tables, so loading makes a fixed number of allocations however many timesteps there are */
+class OrderStore {
+	public:
+		OrderStore();
+		/** most products a store holds, the product column keeps their indexes in 16 bits */
+		static const size_t maxProducts = 65536;
+
+		/** adds a row to the end of the store, interning its timestamp and product.
+			Returns false and adds nothing if its product is new and the store already holds maxProducts products */
+		bool append(double price,
+					double amount,
+					int64_t timestamp,
+					std::string_view product,
+					OrderBookType orderType);
+		/** adds a row whose timestamp and product are already indexes into this store's dictionaries */
+		void appendRow(double price, double amount, uint32_t timestep, uint16_t product, OrderBookType orderType);
+		/** reserves space for the sent number of rows in every column */
+		void reserve(size_t rows);
+		/** number of rows in the store */
+		size_t size() const;
+		/** builds the OrderBookEntry of the sent row, for code that works with whole entries */
+		OrderBookEntry getEntry(size_t row) const;
+		/** frees the row columns and keeps the dictionaries, for books whose rows live in a BlockFile */
+		void releaseRows();
+		/** returns the approximate number of bytes held by the columns and dictionaries */
+		size_t memoryUsage() const;
+
+		/** returns the index of the sent value in the dictionary, adding it if it is new */
+		uint32_t internTimestamp(int64_t timestamp);
+		/** the same for products, of which there may be at most maxProducts */
+		uint16_t internProduct(std::string_view product);
+		/** index of the sent product in products through the hash table, or products.size() if it is not there */
+		size_t findProduct(std::string_view product) const;
+
+		// columns, row i is made of element i of each of them
+		std::vector<double> price;
+		std::vector<double> amount;
+		std::vector<uint32_t> timestep;
+		std::vector<uint16_t> product;
+		std::vector<uint8_t> orderType;
+
+		// dictionaries, in the order their values were first seen. The few product names are short enough
+		// to be kept in their strings without allocating
+		std::vector<int64_t> timestamps;
+		std::vector<std::string> products;
+
+	private:
+		/** open addressing hash table over a dictionary of strings or times. A slot holds the index of its value + 1, 0 if it is empty */
+		class DictionaryIndex {
+			public:
+				/** index of value in values, or values.size() if it is not there */
+				template <typename Values, typename Value>
+				size_t find(const Values& values, const Value& value) const {
+					if (slots.empty()) return values.size();
+					for (size_t slot = hashOf(value) & (slots.size() - 1); slots[slot] != 0; slot = (slot + 1) & (slots.size() - 1)) {
+						if (values[slots[slot] - 1] == value) return slots[slot] - 1;
+					}
+					return values.size();
+				}
+				/** adds values[id] to the table, which is kept at most half full */
+				template <typename Values>
+				void insert(const Values& values, size_t id) {
+					if ((values.size() + 1) * 2 > slots.size()) {
+						slots.assign(std::max<size_t>(slots.size() * 2, 64), 0);
+						for (size_t i = 0; i < values.size(); i++) {
+							if (i != id) place(values[i], i);
+						}
+					}
+					place(values[id], id);
+				}
+
+			private:
+				static size_t hashOf(std::string_view value) { return std::hash<std::string_view>{}(value); }
+				/** the splitmix64 finalizer, times of one file differ in few bits */
+				static size_t hashOf(int64_t value) {
+					uint64_t z = static_cast<uint64_t>(value);
+					z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+					z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+					return static_cast<size_t>(z ^ (z >> 31));
+				}
+				template <typename Value>
+				void place(const Value& value, size_t id) {
+					size_t slot = hashOf(value) & (slots.size() - 1);
+					while (slots[slot] != 0) slot = (slot + 1) & (slots.size() - 1);
+					slots[slot] = static_cast<uint32_t>(id + 1);
+				}
+				std::vector<uint32_t> slots;
+		};
+
+		DictionaryIndex timestampIndex;
+		DictionaryIndex productIndex;
+		/** product of the last interned row */
+		uint16_t lastProduct;
+};
@@ -0,0 +1,307 @@
+#include "PriceKernels.h"
+#include <atomic>
+#include <initializer_list>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PRICE_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// the versions only match if multiplies and adds are rounded separately, so the compiler must not fuse them into multiply-adds.
+// clang takes the standard pragma, gcc ignores it and is told on each function that multiplies and adds, MSVC does not fuse
+// them under its default /fp:precise
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#define NO_FP_CONTRACT
+#elif defined(__GNUC__)
+#define NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define NO_FP_CONTRACT
+#endif
+
+// MSVC compiles any intrinsic without flags, gcc and clang need the instruction set enabled on each function using it
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KERNEL_TARGET(isa)
+#else
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+
+	/** every version reduces element i into lane i % lanes */
+	const size_t lanes = 8;
+
+	/** per lane partial results, the state every version hands over to finish() */
+	struct LaneState {
+		double min[lanes];
+		double max[lanes];
+		double priceSum[lanes];
+		double amountSum[lanes];
+		double notional[lanes];
+	};
+
+	void initLanes(LaneState& state) {
+		for (size_t j = 0; j < lanes; j++) {
+			state.min[j] = std::numeric_limits<double>::infinity();
+			state.max[j] = -std::numeric_limits<double>::infinity();
+			state.priceSum[j] = 0;
+			state.amountSum[j] = 0;
+			state.notional[j] = 0;
+		}
+	}
+
+	// same operand order as minpd / maxpd, so NaN and signed zeros come out the same on every version
+	inline double laneMin(double value, double current) { return value < current ? value : current; }
+	inline double laneMax(double value, double current) { return value > current ? value : current; }
+
+	/** sum of the lanes, in a fixed pairwise order */
+	double combineSum(const double* lane) {
+		return ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));
+	}
+
+	/** combines the lanes and adds the elements from done to count that did not fill a block of lanes */
+	NO_FP_CONTRACT
+	PriceSummary finish(const LaneState& state, const double* prices, const double* amounts, size_t done, size_t count) {
+		PriceSummary summary;
+		summary.count = count;
+		if (count == 0) {
+			return summary;
+		}
+		double min = state.min[0];
+		double max = state.max[0];
+		for (size_t j = 1; j < lanes; j++) {
+			min = laneMin(state.min[j], min);
+			max = laneMax(state.max[j], max);
+		}
+		double priceSum = combineSum(state.priceSum);
+		double amountSum = combineSum(state.amountSum);
+		double notional = combineSum(state.notional);
+		for (size_t i = done; i < count; i++) {
+			min = laneMin(prices[i], min);
+			max = laneMax(prices[i], max);
+			priceSum += prices[i];
+			if (amounts != nullptr) {
+				amountSum += amounts[i];
+				notional += prices[i] * amounts[i];
+			}
+		}
+		summary.min = min;
+		summary.max = max;
+		summary.priceSum = priceSum;
+		if (amounts != nullptr) {
+			summary.amountSum = amountSum;
+			summary.notional = notional;
+		}
+		return summary;
+	}
+
+	NO_FP_CONTRACT
+	PriceSummary summariseScalar(const double* prices, const double* amounts, size_t count) {
+		LaneState state;
+		initLanes(state);
+		size_t blocks = count / lanes * lanes;
+		for (size_t i = 0; i < blocks; i += lanes) {
+			for (size_t j = 0; j < lanes; j++) {
+				double price = prices[i + j];
+				state.min[j] = laneMin(price, state.min[j]);
+				state.max[j] = laneMax(price, state.max[j]);
+				state.priceSum[j] += price;
+			}
+			if (amounts == nullptr) continue;
+			for (size_t j = 0; j < lanes; j++) {
+				state.amountSum[j] += amounts[i + j];
+				state.notional[j] += prices[i + j] * amounts[i + j];
+			}
+		}
+		return finish(state, prices, amounts, blocks, count);
+	}
+
+#ifdef PRICE_KERNELS_X86
+
+	KERNEL_TARGET("sse2") NO_FP_CONTRACT
+	PriceSummary summariseSSE2(const double* prices, const double* amounts, size_t count) {
+		LaneState state;
+		initLanes(state);
+		// 4 registers of 2 doubles hold the 8 lanes, register k holds lanes 2k and 2k + 1
+		__m128d min[4], max[4], priceSum[4], amountSum[4], notional[4];
+		for (size_t k = 0; k < 4; k++) {
+			min[k] = _mm_loadu_pd(state.min + 2 * k);
+			max[k] = _mm_loadu_pd(state.max + 2 * k);
+			priceSum[k] = amountSum[k] = notional[k] = _mm_setzero_pd();
+		}
+		size_t blocks = count / lanes * lanes;
+		for (size_t i = 0; i < blocks; i += lanes) {
+			for (size_t k = 0; k < 4; k++) {
+				__m128d price = _mm_loadu_pd(prices + i + 2 * k);
+				min[k] = _mm_min_pd(price, min[k]);
+				max[k] = _mm_max_pd(price, max[k]);
+				priceSum[k] = _mm_add_pd(priceSum[k], price);
+				if (amounts == nullptr) continue;
+				__m128d amount = _mm_loadu_pd(amounts + i + 2 * k);
+				amountSum[k] = _mm_add_pd(amountSum[k], amount);
+				notional[k] = _mm_add_pd(notional[k], _mm_mul_pd(price, amount));
+			}
+		}
+		for (size_t k = 0; k < 4; k++) {
+			_mm_storeu_pd(state.min + 2 * k, min[k]);
+			_mm_storeu_pd(state.max + 2 * k, max[k]);
+			_mm_storeu_pd(state.priceSum + 2 * k, priceSum[k]);
+			_mm_storeu_pd(state.amountSum + 2 * k, amountSum[k]);
+			_mm_storeu_pd(state.notional + 2 * k, notional[k]);
+		}
+		return finish(state, prices, amounts, blocks, count);
+	}
+
+	KERNEL_TARGET("avx2") NO_FP_CONTRACT
+	PriceSummary summariseAVX2(const double* prices, const double* amounts, size_t count) {
+		LaneState state;
+		initLanes(state);
+		// 2 registers of 4 doubles hold the 8 lanes
+		__m256d min[2], max[2], priceSum[2], amountSum[2], notional[2];
+		for (size_t k = 0; k < 2; k++) {
+			min[k] = _mm256_loadu_pd(state.min + 4 * k);
+			max[k] = _mm256_loadu_pd(state.max + 4 * k);
+			priceSum[k] = amountSum[k] = notional[k] = _mm256_setzero_pd();
+		}
+		size_t blocks = count / lanes * lanes;
+		for (size_t i = 0; i < blocks; i += lanes) {
+			for (size_t k = 0; k < 2; k++) {
+				__m256d price = _mm256_loadu_pd(prices + i + 4 * k);
+				min[k] = _mm256_min_pd(price, min[k]);
+				max[k] = _mm256_max_pd(price, max[k]);
+				priceSum[k] = _mm256_add_pd(priceSum[k], price);
+				if (amounts == nullptr) continue;
+				__m256d amount = _mm256_loadu_pd(amounts + i + 4 * k);
+				amountSum[k] = _mm256_add_pd(amountSum[k], amount);
+				notional[k] = _mm256_add_pd(notional[k], _mm256_mul_pd(price, amount));
+			}
+		}
+		for (size_t k = 0; k < 2; k++) {
+			_mm256_storeu_pd(state.min + 4 * k, min[k]);
+			_mm256_storeu_pd(state.max + 4 * k, max[k]);
+			_mm256_storeu_pd(state.priceSum + 4 * k, priceSum[k]);
+			_mm256_storeu_pd(state.amountSum + 4 * k, amountSum[k]);
+			_mm256_storeu_pd(state.notional + 4 * k, notional[k]);
+		}
+		return finish(state, prices, amounts, blocks, count);
+	}
+
+	KERNEL_TARGET("avx512f") NO_FP_CONTRACT
+	PriceSummary summariseAVX512(const double* prices, const double* amounts, size_t count) {
+		LaneState state;
+		initLanes(state);
+		// one register of 8 doubles holds the 8 lanes
+		__m512d min = _mm512_loadu_pd(state.min);
+		__m512d max = _mm512_loadu_pd(state.max);
+		__m512d priceSum = _mm512_setzero_pd();
+		__m512d amountSum = _mm512_setzero_pd();
+		__m512d notional = _mm512_setzero_pd();
+		size_t blocks = count / lanes * lanes;
+		for (size_t i = 0; i < blocks; i += lanes) {
+			__m512d price = _mm512_loadu_pd(prices + i);
+			// the masked forms with every lane set, the plain ones start from an undefined register that gcc warns about
+			min = _mm512_mask_min_pd(min, 0xff, price, min);
+			max = _mm512_mask_max_pd(max, 0xff, price, max);
+			priceSum = _mm512_add_pd(priceSum, price);
+			if (amounts == nullptr) continue;
+			__m512d amount = _mm512_loadu_pd(amounts + i);
+			amountSum = _mm512_add_pd(amountSum, amount);
+			notional = _mm512_add_pd(notional, _mm512_mul_pd(price, amount));
+		}
+		_mm512_storeu_pd(state.min, min);
+		_mm512_storeu_pd(state.max, max);
+		_mm512_storeu_pd(state.priceSum, priceSum);
+		_mm512_storeu_pd(state.amountSum, amountSum);
+		_mm512_storeu_pd(state.notional, notional);
+		return finish(state, prices, amounts, blocks, count);
+	}
+
+	bool cpuSupports(PriceKernel kernel) {
+		switch (kernel) {
+#if defined(_MSC_VER) && !defined(__clang__)
+			case PriceKernel::sse2:
+				return true;
+			case PriceKernel::avx2:
+			case PriceKernel::avx512: {
+				int info[4];
+				__cpuid(info, 1);
+				bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6; // osxsave, then xmm and ymm state
+				if (!osSavesYmm) return false;
+				__cpuidex(info, 7, 0);
+				if (kernel == PriceKernel::avx2) return (info[1] & (1 << 5)) != 0;
+				return (info[1] & (1 << 16)) != 0 && (_xgetbv(0) & 0xe6) == 0xe6; // avx512f, then opmask and zmm state
+			}
+#else
+			case PriceKernel::sse2:
+				return __builtin_cpu_supports("sse2");
+			case PriceKernel::avx2:
+				return __builtin_cpu_supports("avx2");
+			case PriceKernel::avx512:
+				return __builtin_cpu_supports("avx512f");
+#endif
+			default:
+				return true;
+		}
+	}
+
+#else
+
+	bool cpuSupports(PriceKernel kernel) {
+		return kernel == PriceKernel::scalar;
+	}
+
+#endif
+
+	PriceKernel widestSupported() {
+		for (PriceKernel kernel : {PriceKernel::avx512, PriceKernel::avx2, PriceKernel::sse2}) {
+			if (cpuSupports(kernel)) return kernel;
+		}
+		return PriceKernel::scalar;
+	}
+
+	std::atomic<PriceKernel>& activeKernel() {
+		static std::atomic<PriceKernel> kernel{widestSupported()};
+		return kernel;
+	}
+
+}
+
+PriceSummary PriceKernels::summarise(const double* prices, const double* amounts, size_t count) {
+	switch (active()) {
+#ifdef PRICE_KERNELS_X86
+		case PriceKernel::avx512: return summariseAVX512(prices, amounts, count);
+		case PriceKernel::avx2: return summariseAVX2(prices, amounts, count);
+		case PriceKernel::sse2: return summariseSSE2(prices, amounts, count);
+#endif
+		default: return summariseScalar(prices, amounts, count);
+	}
+}
+
+PriceKernel PriceKernels::active() {
+	return activeKernel().load(std::memory_order_relaxed);
+}
+
+bool PriceKernels::select(PriceKernel kernel) {
+	if (!supported(kernel)) {
+		return false;
+	}
+	activeKernel().store(kernel, std::memory_order_relaxed);
+	return true;
+}
+
+bool PriceKernels::supported(PriceKernel kernel) {
+	return kernel == PriceKernel::scalar || cpuSupports(kernel);
+}
+
+const char* PriceKernels::name(PriceKernel kernel) {
+	switch (kernel) {
+		case PriceKernel::sse2: return "sse2";
+		case PriceKernel::avx2: return "avx2";
+		case PriceKernel::avx512: return "avx512";
+		default: return "scalar";
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+
+/** Instruction sets a price kernel can be compiled for, in increasing order of width */
+enum class PriceKernel { scalar, sse2, avx2, avx512 };
+
+/** Result of PriceKernels::summarise. min and max are 0 when count is 0 */
+struct PriceSummary {
+	double min = 0;
+	double max = 0;
+	/** sum of the prices */
+	double priceSum = 0;
+	/** sum of the amounts, 0 when no amounts were sent */
+	double amountSum = 0;
+	/** sum of price * amount, 0 when no amounts were sent */
+	double notional = 0;
+	size_t count = 0;
+};
+
+/** Reductions over contiguous price and amount columns, shared by the statistics of the OrderBook and the code scanning its rows.
+	Each one has a scalar, SSE2, AVX2 and AVX-512 version, the widest the cpu supports is chosen the first time one is called.
+	Every version accumulates into the same 8 lanes and combines them in the same order, so they all return bit-identical results.
+	Only a nan result can differ in its sign and payload, the language leaves those open */
+class PriceKernels {
+	public:
+		/** min, max and sum of count prices, and sums of the amounts and of price * amount when amounts is not nullptr */
+		static PriceSummary summarise(const double* prices, const double* amounts, size_t count);
+
+		/** the version summarise currently runs */
+		static PriceKernel active();
+		/** switches to the sent version, for comparing them (see Benchmark). Returns false and keeps the current one if the cpu does not support it */
+		static bool select(PriceKernel kernel);
+		/** true if the cpu and operating system support the sent version */
+		static bool supported(PriceKernel kernel);
+		static const char* name(PriceKernel kernel);
+};
@@ -0,0 +1,107 @@
+#include "RangeSeries.h"
+#include <algorithm>
+#include <limits>
+
+RangeSeries::RangeSeries(int _queries) : queries(_queries), count(0), prefix(1, 0.0), leaves(0) {
+
+}
+
+void RangeSeries::append(double value) {
+	append(value, value, value);
+}
+
+void RangeSeries::appendMissing() {
+	append(0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity());
+}
+
+void RangeSeries::append(double sumValue, double minValue, double maxValue) {
+	if (queries & sums) {
+		prefix.push_back(prefix.back() + sumValue);
+	}
+	if (queries & (minimum | maximum)) {
+		if (count == leaves) {
+			grow();
+		}
+		size_t node = leaves + count;
+		if (queries & minimum) minTree[node] = minValue;
+		if (queries & maximum) maxTree[node] = maxValue;
+		for (node /= 2; node >= 1; node /= 2) { // only the ancestors of the new leaf change
+			if (queries & minimum) minTree[node] = std::min(minTree[2 * node], minTree[2 * node + 1]);
+			if (queries & maximum) maxTree[node] = std::max(maxTree[2 * node], maxTree[2 * node + 1]);
+		}
+	}
+	count++;
+}
+
+void RangeSeries::reserve(size_t values) {
+	if (queries & sums) {
+		prefix.reserve(values + 1);
+	}
+	if (queries & (minimum | maximum)) {
+		while (leaves < values) grow();
+	}
+}
+
+void RangeSeries::grow() {
+	size_t newLeaves = leaves == 0 ? 64 : leaves * 2;
+	const double infinity = std::numeric_limits<double>::infinity();
+	std::vector<double> newMin;
+	std::vector<double> newMax;
+	if (queries & minimum) newMin.assign(2 * newLeaves, infinity);
+	if (queries & maximum) newMax.assign(2 * newLeaves, -infinity);
+	for (size_t i = 0; i < count; i++) {
+		if (queries & minimum) newMin[newLeaves + i] = minTree[leaves + i];
+		if (queries & maximum) newMax[newLeaves + i] = maxTree[leaves + i];
+	}
+	for (size_t node = newLeaves - 1; node >= 1; node--) {
+		if (queries & minimum) newMin[node] = std::min(newMin[2 * node], newMin[2 * node + 1]);
+		if (queries & maximum) newMax[node] = std::max(newMax[2 * node], newMax[2 * node + 1]);
+	}
+	minTree = std::move(newMin);
+	maxTree = std::move(newMax);
+	leaves = newLeaves;
+}
+
+size_t RangeSeries::size() const {
+	return count;
+}
+
+double RangeSeries::sum(size_t first, size_t last) const {
+	return prefix[last + 1] - prefix[first];
+}
+
+double RangeSeries::mean(size_t first, size_t last) const {
+	return sum(first, last) / (last - first + 1);
+}
+
+double RangeSeries::min(size_t first, size_t last) const {
+	return query(minTree, leaves, first, last, true);
+}
+
+double RangeSeries::max(size_t first, size_t last) const {
+	return query(maxTree, leaves, first, last, false);
+}
+
+double RangeSeries::query(const std::vector<double>& tree, size_t leaves, size_t first, size_t last, bool lowest) {
+	// bottom-up walk, combining the nodes that cover the edges of [first, last]
+	double result = lowest ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+	size_t l = first + leaves;
+	size_t r = last + leaves + 1;
+	while (l < r) {
+		if (l & 1) {
+			result = lowest ? std::min(result, tree[l]) : std::max(result, tree[l]);
+			l++;
+		}
+		if (r & 1) {
+			r--;
+			result = lowest ? std::min(result, tree[r]) : std::max(result, tree[r]);
+		}
+		l /= 2;
+		r /= 2;
+	}
+	return result;
+}
+
+size_t RangeSeries::memoryUsage() const {
+	return (prefix.capacity() + minTree.capacity() + maxTree.capacity()) * sizeof(double);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/** A series of values, one per timestep, answering sum, mean, min and max over any range of it without walking the range.
+	Sums come from prefix sums in O(1), min and max from segment trees in O(log n). Values can only be appended */
+class RangeSeries {
+	public:
+		/** queries a series can answer, only the structures they need are kept */
+		enum Queries { sums = 1, minimum = 2, maximum = 4 };
+
+		RangeSeries(int queries = sums | minimum | maximum);
+		/** adds the value of the next timestep, O(log n) */
+		void append(double value);
+		/** adds a timestep without a value. It counts as 0 in sums and is ignored by min and max */
+		void appendMissing();
+		/** makes room for the sent number of values, so appending up to them does not allocate */
+		void reserve(size_t values);
+		/** number of values in the series */
+		size_t size() const;
+
+		/** ranges are inclusive, first <= last < size() */
+		double sum(size_t first, size_t last) const;
+		double mean(size_t first, size_t last) const;
+		/** +infinity / -infinity when every timestep of the range is missing */
+		double min(size_t first, size_t last) const;
+		double max(size_t first, size_t last) const;
+
+		/** returns the approximate number of bytes held by the series */
+		size_t memoryUsage() const;
+
+	private:
+		/** doubles the number of leaves of the trees, keeping the values */
+		void grow();
+		void append(double sumValue, double minValue, double maxValue);
+		static double query(const std::vector<double>& tree, size_t leaves, size_t first, size_t last, bool lowest);
+
+		int queries;
+		size_t count;
+		/** prefix[i] is the sum of the first i values */
+		std::vector<double> prefix;
+		/** number of leaves of the trees, a power of two. Leaf i is tree[leaves + i], node n combines nodes 2n and 2n + 1 */
+		size_t leaves;
+		std::vector<double> minTree;
+		std::vector<double> maxTree;
+};
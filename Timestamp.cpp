@@ -0,0 +1,95 @@
+#include "Timestamp.h"
+
+bool Timestamp::readDigits(std::string_view text, size_t position, size_t count, unsigned int& value) {
+	value = 0;
+	for (size_t i = position; i < position + count; i++) {
+		if (text[i] < '0' || text[i] > '9') return false;
+		value = value * 10 + static_cast<unsigned int>(text[i] - '0');
+	}
+	return true;
+}
+
+int64_t Timestamp::daysFromCivil(int64_t year, unsigned int month, unsigned int day) {
+	year -= month <= 2 ? 1 : 0;
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int64_t yearOfEra = year - era * 400;
+	int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+bool Timestamp::parseTimeOfDay(std::string_view text, int64_t& time) { // hh:mm:ss[.f], the fraction is read as microseconds padded on the right
+	unsigned int hours, minutes, seconds;
+	if (text.size() < 8 || text[2] != ':' || text[5] != ':'
+		|| !readDigits(text, 0, 2, hours) || !readDigits(text, 3, 2, minutes) || !readDigits(text, 6, 2, seconds)
+		|| hours > 23 || minutes > 59 || seconds > 59) {
+		return false;
+	}
+	unsigned int microseconds = 0;
+	if (text.size() > 8) {
+		size_t digits = text.size() - 9;
+		if (text[8] != '.' || digits == 0 || digits > 6 || !readDigits(text, 9, digits, microseconds)) {
+			return false;
+		}
+		for (size_t i = digits; i < 6; i++) microseconds *= 10;
+	}
+	time = ((hours * 60 + minutes) * 60 + seconds) * microsecondsPerSecond + microseconds;
+	return true;
+}
+
+bool Timestamp::parse(std::string_view text, int64_t& time) {
+	unsigned int year, month, day;
+	if (text.size() < 19 || text[4] != '/' || text[7] != '/' || text[10] != ' '
+		|| !readDigits(text, 0, 4, year) || !readDigits(text, 5, 2, month) || !readDigits(text, 8, 2, day)
+		|| month < 1 || month > 12 || day < 1 || day > 31) {
+		return false;
+	}
+	int64_t timeOfDay;
+	if (!parseTimeOfDay(text.substr(11), timeOfDay)) {
+		return false;
+	}
+	time = daysFromCivil(year, month, day) * microsecondsPerDay + timeOfDay;
+	return true;
+}
+
+int64_t Timestamp::startOfDay(int64_t time) {
+	int64_t days = time / microsecondsPerDay - (time % microsecondsPerDay < 0 ? 1 : 0);
+	return days * microsecondsPerDay;
+}
+
+void Timestamp::format(int64_t time, char* out) {
+	int64_t midnight = startOfDay(time);
+	int64_t timeOfDay = time - midnight;
+	// civil date of a day number, after Howard Hinnant's civil_from_days
+	int64_t z = midnight / microsecondsPerDay + 719468;
+	int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	int64_t dayOfEra = z - era * 146097;
+	int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+	int64_t day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+	int64_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+	int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+	auto put = [&out](int64_t value, int digits, char after) {
+		for (int i = digits - 1; i >= 0; i--) {
+			out[i] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		}
+		out += digits;
+		if (after != '\0') *out++ = after;
+	};
+	put(year, 4, '/');
+	put(month, 2, '/');
+	put(day, 2, ' ');
+	put(timeOfDay / (3600 * microsecondsPerSecond), 2, ':');
+	put(timeOfDay / (60 * microsecondsPerSecond) % 60, 2, ':');
+	put(timeOfDay / microsecondsPerSecond % 60, 2, '.');
+	put(timeOfDay % microsecondsPerSecond, 6, '\0');
+}
+
+std::string Timestamp::format(int64_t time) {
+	std::string text(formattedLength, ' ');
+	format(time, &text[0]);
+	return text;
+}
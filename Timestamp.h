@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/** Timestamps of the datasets, "yyyy/mm/dd hh:mm:ss.uuuuuu", held as microseconds since 1970/01/01 00:00:00.
+	They are parsed once when a file is read and compared as integers, the text is only made again for output */
+class Timestamp {
+	public:
+		static const int64_t microsecondsPerSecond = 1000000;
+		static const int64_t microsecondsPerDay = 86400 * microsecondsPerSecond;
+		/** characters written by format */
+		static const size_t formattedLength = 26;
+
+		/** parses "yyyy/mm/dd hh:mm:ss" with an optional fraction of up to 6 digits, returns false if text is anything else */
+		static bool parse(std::string_view text, int64_t& time);
+		/** parses "hh:mm:ss" with an optional fraction of up to 6 digits into microseconds since midnight */
+		static bool parseTimeOfDay(std::string_view text, int64_t& time);
+		/** writes the time as "yyyy/mm/dd hh:mm:ss.uuuuuu", formattedLength characters without a terminating zero */
+		static void format(int64_t time, char* out);
+		static std::string format(int64_t time);
+		/** the midnight the time is on */
+		static int64_t startOfDay(int64_t time);
+
+	private:
+		/** days from 1970/01/01 to the sent date, after Howard Hinnant's days_from_civil */
+		static int64_t daysFromCivil(int64_t year, unsigned int month, unsigned int day);
+		/** reads count digits from text at position, returns false if one of them is not a digit */
+		static bool readDigits(std::string_view text, size_t position, size_t count, unsigned int& value);
+};